@@ -0,0 +1,225 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "circuit_breaker.h"
+
+#include <limits.h>
+
+namespace error {
+namespace {
+
+const int kDefaultFailurePercent = 50;
+const int kDefaultMinCalls = 10;
+const int64_t kDefaultWindowMicros = 10000000;
+const int64_t kDefaultOpenMicros = 5000000;
+
+// Marks circuits that aren't assigned to any library. This can't be
+// kUnspecified, since errors without a library number are tracked too.
+const int kNoLibrary = INT_MIN;
+
+// Returns a non-zero value that identifies the calling thread.
+uintptr_t ThisThread() {
+  static thread_local char marker;
+  return reinterpret_cast<uintptr_t>(&marker);
+}
+
+} // namespace
+
+const int CircuitBreaker::kMaxLibraries;
+
+CircuitBreakerPolicy::CircuitBreakerPolicy()
+    : failure_percent(kDefaultFailurePercent), min_calls(kDefaultMinCalls),
+      window_micros(kDefaultWindowMicros), open_micros(kDefaultOpenMicros) {}
+
+CircuitBreaker::CircuitBreaker(const CircuitBreakerPolicy &policy)
+    : CircuitBreaker(policy, SystemClock()) {}
+
+CircuitBreaker::CircuitBreaker(const CircuitBreakerPolicy &policy,
+                               Clock *clock)
+    : policy_(policy), clock_(clock) {
+  int64_t now_micros = clock_->NowMicros();
+  for (int i = 0; i < kMaxLibraries; ++i) {
+    Circuit &circuit = circuits_[i];
+    circuit.library_number.store(kNoLibrary);
+    circuit.state.store(CLOSED);
+    circuit.window_start_micros.store(now_micros);
+    circuit.calls.store(0);
+    circuit.failures.store(0);
+    circuit.opened_at_micros.store(0);
+    circuit.probe_thread.store(0);
+    circuit.error_sequence.store(0);
+    circuit.canonical_code.store(Error::UNKNOWN);
+    circuit.error_library_number.store(kUnspecified);
+    circuit.error_number.store(kUnspecified);
+    circuit.subcode.store(kUnspecified);
+  }
+}
+
+CircuitBreaker::~CircuitBreaker() {}
+
+bool CircuitBreaker::Allow(int library_number) {
+  Circuit *circuit = Find(library_number);
+  if (circuit == nullptr) {
+    return true;
+  }
+
+  int state = circuit->state.load(std::memory_order_acquire);
+  if (state == CLOSED) {
+    return true;
+  }
+  if (state == HALF_OPEN) {
+    return false;
+  }
+
+  int64_t now_micros = clock_->NowMicros();
+  if (now_micros - circuit->opened_at_micros.load(std::memory_order_relaxed) <
+      policy_.open_micros) {
+    return false;
+  }
+  // Only the caller that wins the transition gets to probe.
+  if (!circuit->state.compare_exchange_strong(state, HALF_OPEN,
+                                              std::memory_order_acq_rel)) {
+    return false;
+  }
+  circuit->probe_thread.store(ThisThread(), std::memory_order_release);
+  return true;
+}
+
+void CircuitBreaker::Record(int library_number, const Error &error) {
+  Circuit *circuit = Find(library_number);
+  if (circuit == nullptr) {
+    return;
+  }
+
+  int state = circuit->state.load(std::memory_order_acquire);
+  if (state == OPEN) {
+    // A call that started before the circuit opened.
+    return;
+  }
+
+  int64_t now_micros = clock_->NowMicros();
+  if (state == HALF_OPEN) {
+    // Calls allowed before the circuit opened can finish while the probe is
+    // in progress, their results are ignored.
+    if (circuit->probe_thread.load(std::memory_order_acquire) !=
+        ThisThread()) {
+      return;
+    }
+    circuit->probe_thread.store(0, std::memory_order_relaxed);
+    if (error.Ok()) {
+      circuit->calls.store(0, std::memory_order_relaxed);
+      circuit->failures.store(0, std::memory_order_relaxed);
+      circuit->window_start_micros.store(now_micros,
+                                         std::memory_order_relaxed);
+      circuit->state.store(CLOSED, std::memory_order_release);
+    } else {
+      Open(circuit, error, now_micros);
+    }
+    return;
+  }
+
+  int64_t window_start_micros =
+      circuit->window_start_micros.load(std::memory_order_relaxed);
+  if (now_micros - window_start_micros >= policy_.window_micros &&
+      circuit->window_start_micros.compare_exchange_strong(
+          window_start_micros, now_micros, std::memory_order_relaxed)) {
+    circuit->calls.store(0, std::memory_order_relaxed);
+    circuit->failures.store(0, std::memory_order_relaxed);
+  }
+
+  uint32_t calls = circuit->calls.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (error.Ok()) {
+    return;
+  }
+  uint32_t failures =
+      circuit->failures.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint32_t failure_percent = static_cast<uint32_t>(policy_.failure_percent);
+  if (calls >= static_cast<uint32_t>(policy_.min_calls) &&
+      failures * 100 >= calls * failure_percent) {
+    Open(circuit, error, now_micros);
+  }
+}
+
+CircuitBreaker::State CircuitBreaker::GetState(int library_number) {
+  Circuit *circuit = Find(library_number);
+  if (circuit == nullptr) {
+    return CLOSED;
+  }
+  return static_cast<State>(circuit->state.load(std::memory_order_acquire));
+}
+
+Error CircuitBreaker::CachedError(int library_number) {
+  Circuit *circuit = Find(library_number);
+  if (circuit == nullptr) {
+    return Error::UNKNOWN;
+  }
+  for (;;) {
+    uint32_t sequence =
+        circuit->error_sequence.load(std::memory_order_acquire);
+    Error error(static_cast<Error::Code>(
+                    circuit->canonical_code.load(std::memory_order_relaxed)),
+                circuit->error_library_number.load(std::memory_order_relaxed),
+                circuit->error_number.load(std::memory_order_relaxed),
+                circuit->subcode.load(std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence % 2 == 0 &&
+        circuit->error_sequence.load(std::memory_order_relaxed) == sequence) {
+      return error;
+    }
+  }
+}
+
+CircuitBreaker::Circuit *CircuitBreaker::Find(int library_number) {
+  // Open addressing with linear probing. Circuits are assigned on first use
+  // and never released, so the first free circuit is claimed by the library.
+  unsigned start = static_cast<unsigned>(library_number) * 2654435761u;
+  for (int i = 0; i < kMaxLibraries; ++i) {
+    Circuit &circuit = circuits_[(start + i) % kMaxLibraries];
+    int assigned = circuit.library_number.load(std::memory_order_acquire);
+    if (assigned == library_number) {
+      return &circuit;
+    }
+    if (assigned == kNoLibrary &&
+        (circuit.library_number.compare_exchange_strong(
+             assigned, library_number, std::memory_order_acq_rel) ||
+         assigned == library_number)) {
+      return &circuit;
+    }
+  }
+  return nullptr;
+}
+
+void CircuitBreaker::Open(Circuit *circuit, const Error &error,
+                          int64_t now_micros) {
+  // If another failure is caching its error at the same time, that error is
+  // kept and this one is dropped, so the failure path never waits.
+  uint32_t sequence = circuit->error_sequence.load(std::memory_order_relaxed);
+  if (sequence % 2 == 0 &&
+      circuit->error_sequence.compare_exchange_strong(
+          sequence, sequence + 1, std::memory_order_relaxed)) {
+    std::atomic_thread_fence(std::memory_order_release);
+    circuit->canonical_code.store(error.CanonicalCode(),
+                                  std::memory_order_relaxed);
+    circuit->error_library_number.store(error.LibraryNumber(),
+                                        std::memory_order_relaxed);
+    circuit->error_number.store(error.ErrorNumber(),
+                                std::memory_order_relaxed);
+    circuit->subcode.store(error.Subcode(), std::memory_order_relaxed);
+    circuit->error_sequence.store(sequence + 2, std::memory_order_release);
+  }
+  circuit->opened_at_micros.store(now_micros, std::memory_order_relaxed);
+  circuit->state.store(OPEN, std::memory_order_release);
+}
+
+} // namespace error
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A circuit breaker that sheds calls into failing libraries.
+// Only available in native builds (-DNATIVE_BUILD).
+#ifndef ARDUINO_ERROR_CIRCUIT_BREAKER_H
+#define ARDUINO_ERROR_CIRCUIT_BREAKER_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "clock.h"
+#include "error.h"
+
+namespace error {
+
+// Determines when a circuit opens and for how long.
+struct CircuitBreakerPolicy {
+  // Creates a policy with the default values.
+  CircuitBreakerPolicy();
+
+  // The circuit opens when at least this percentage of the calls within the
+  // current window failed. Defaults to 50.
+  int failure_percent;
+
+  // The minimum number of calls within the window before the circuit can
+  // open. Defaults to 10.
+  int min_calls;
+
+  // The length of the window over which the failures are counted, defaults to
+  // 10 seconds.
+  int64_t window_micros;
+
+  // How long the circuit stays open before a probe call is let through,
+  // defaults to 5 seconds.
+  int64_t open_micros;
+};
+
+// Tracks the error rate of calls into other libraries, keyed by the library
+// number, and rejects calls into a library whose error rate is too high.
+//
+// A circuit starts closed and lets all calls through. Once the failure rate
+// reaches the threshold, the circuit opens and the calls are rejected
+// immediately with the last error the library returned. After the open period
+// the circuit becomes half-open and lets a single probe call through. A
+// successful probe closes the circuit, a failed one opens it again.
+//
+// All methods are thread-safe. Up to kMaxLibraries distinct library numbers
+// are tracked, calls into further libraries are never rejected.
+//
+// Example use:
+//   CircuitBreaker breaker{CircuitBreakerPolicy()};
+//
+//   ErrorOr<int> ReadModem() {
+//     return breaker.Call(kModemLibrary, []() { return modem.Read(); });
+//   }
+class CircuitBreaker {
+public:
+  // The states of a circuit.
+  enum State {
+    // Calls are let through.
+    CLOSED,
+    // Calls are rejected.
+    OPEN,
+    // A single probe call is in progress, other calls are rejected.
+    HALF_OPEN,
+  };
+
+  // The maximum number of tracked library numbers.
+  static const int kMaxLibraries = 64;
+
+  // The clock defaults to SystemClock() and must outlive the breaker.
+  explicit CircuitBreaker(const CircuitBreakerPolicy &policy);
+  CircuitBreaker(const CircuitBreakerPolicy &policy, Clock *clock);
+  ~CircuitBreaker();
+
+  // Calls the function unless the circuit for the library is open, in which
+  // case it returns the cached error without calling it. The function must
+  // return ::error::Error or ::error::ErrorOr<T>, its result is recorded and
+  // returned.
+  template <typename Function>
+  auto Call(int library_number, Function function) -> decltype(function());
+
+  // Determines if a call into the library should be made. Each call that was
+  // allowed must be followed by a call to Record() from the same thread.
+  bool Allow(int library_number);
+
+  // Records the result of a call into the library. While the circuit is
+  // half-open, only the result of the probe call is taken into account.
+  void Record(int library_number, const Error &error);
+
+  // Returns the state of the circuit for the library.
+  State GetState(int library_number);
+
+  // Returns the error that calls into the library are rejected with. This is
+  // the error that caused the circuit to open, or one of the errors if several
+  // calls opened it at the same time.
+  Error CachedError(int library_number);
+
+private:
+  // The counters of a single library.
+  struct Circuit {
+    std::atomic<int> library_number;
+    std::atomic<int> state;
+    std::atomic<int64_t> window_start_micros;
+    std::atomic<uint32_t> calls;
+    std::atomic<uint32_t> failures;
+    std::atomic<int64_t> opened_at_micros;
+    // Identifies the thread that makes the probe call while the circuit is
+    // half-open, zero otherwise.
+    std::atomic<uintptr_t> probe_thread;
+    // A sequence lock around the fields of the cached error. It is odd while
+    // the fields are written, so that readers never see a mix of two errors.
+    std::atomic<uint32_t> error_sequence;
+    std::atomic<int> canonical_code;
+    std::atomic<int> error_library_number;
+    std::atomic<int> error_number;
+    std::atomic<int> subcode;
+  };
+
+  // Not copyable.
+  CircuitBreaker(const CircuitBreaker &);
+  CircuitBreaker &operator=(const CircuitBreaker &);
+
+  // Returns the circuit for the library or nullptr if all circuits are taken
+  // by other libraries.
+  Circuit *Find(int library_number);
+
+  // Moves the circuit into the OPEN state caused by the provided error.
+  void Open(Circuit *circuit, const Error &error, int64_t now_micros);
+
+  const CircuitBreakerPolicy policy_;
+  Clock *clock_;
+  Circuit circuits_[kMaxLibraries];
+};
+
+//
+// Implementation details of the CircuitBreaker class.
+//
+
+template <typename Function>
+inline auto CircuitBreaker::Call(int library_number, Function function)
+    -> decltype(function()) {
+  if (!Allow(library_number)) {
+    return CachedError(library_number);
+  }
+  auto result = function();
+  Record(library_number, result.GetError());
+  return result;
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_CIRCUIT_BREAKER_H
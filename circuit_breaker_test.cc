@@ -0,0 +1,265 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "circuit_breaker.h"
+
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "error_or.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "testing/fake_clock.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::FakeClock;
+using ::testing::error::IsOkAndHolds;
+
+const int kLibraryNumber = 11;
+const int kOtherLibraryNumber = 12;
+const int kErrorNumber = 4;
+
+CircuitBreakerPolicy TestPolicy() {
+  CircuitBreakerPolicy policy;
+  policy.failure_percent = 50;
+  policy.min_calls = 4;
+  policy.window_micros = 1000;
+  policy.open_micros = 500;
+  return policy;
+}
+
+Error Failure() {
+  return Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber);
+}
+
+// Records calls until the circuit for kLibraryNumber opens.
+void OpenCircuit(CircuitBreaker *breaker) {
+  for (int i = 0; i < 4; ++i) {
+    breaker->Record(kLibraryNumber, Failure());
+  }
+  ASSERT_EQ(CircuitBreaker::OPEN, breaker->GetState(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, ClosedByDefault) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.GetState(kLibraryNumber));
+  EXPECT_TRUE(breaker.Allow(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, StaysClosedBelowMinCalls) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  for (int i = 0; i < 3; ++i) {
+    breaker.Record(kLibraryNumber, Failure());
+  }
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.GetState(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, StaysClosedBelowFailureRate) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  for (int i = 0; i < 10; ++i) {
+    breaker.Record(kLibraryNumber, Error::OK);
+    breaker.Record(kLibraryNumber, Error::OK);
+    breaker.Record(kLibraryNumber, Failure());
+  }
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.GetState(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, OpensAtFailureRate) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  breaker.Record(kLibraryNumber, Error::OK);
+  breaker.Record(kLibraryNumber, Error::OK);
+  breaker.Record(kLibraryNumber, Failure());
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.GetState(kLibraryNumber));
+  breaker.Record(kLibraryNumber, Failure());
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.GetState(kLibraryNumber));
+  EXPECT_FALSE(breaker.Allow(kLibraryNumber));
+  EXPECT_THAT(breaker.CachedError(kLibraryNumber),
+              ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber));
+}
+
+TEST(CircuitBreakerTest, ForgetsFailuresFromPreviousWindow) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  for (int i = 0; i < 3; ++i) {
+    breaker.Record(kLibraryNumber, Failure());
+  }
+  clock.AdvanceMicros(1000);
+  breaker.Record(kLibraryNumber, Failure());
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.GetState(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, TracksLibrariesIndependently) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  OpenCircuit(&breaker);
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.GetState(kOtherLibraryNumber));
+  EXPECT_TRUE(breaker.Allow(kOtherLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, HalfOpensAfterOpenPeriod) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  OpenCircuit(&breaker);
+
+  clock.AdvanceMicros(499);
+  EXPECT_FALSE(breaker.Allow(kLibraryNumber));
+  clock.AdvanceMicros(1);
+  EXPECT_TRUE(breaker.Allow(kLibraryNumber));
+  EXPECT_EQ(CircuitBreaker::HALF_OPEN, breaker.GetState(kLibraryNumber));
+  // Only a single probe is let through.
+  EXPECT_FALSE(breaker.Allow(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, SuccessfulProbeCloses) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  OpenCircuit(&breaker);
+  clock.AdvanceMicros(500);
+  ASSERT_TRUE(breaker.Allow(kLibraryNumber));
+  breaker.Record(kLibraryNumber, Error::OK);
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.GetState(kLibraryNumber));
+  EXPECT_TRUE(breaker.Allow(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, FailedProbeReopens) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  OpenCircuit(&breaker);
+  clock.AdvanceMicros(500);
+  ASSERT_TRUE(breaker.Allow(kLibraryNumber));
+  breaker.Record(kLibraryNumber, Error(Error::UNKNOWN, kLibraryNumber));
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.GetState(kLibraryNumber));
+  EXPECT_THAT(breaker.CachedError(kLibraryNumber),
+              ErrorIs(Error::UNKNOWN, kLibraryNumber));
+  clock.AdvanceMicros(499);
+  EXPECT_FALSE(breaker.Allow(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, IgnoresResultsOfOtherCallsWhileHalfOpen) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  OpenCircuit(&breaker);
+  clock.AdvanceMicros(500);
+  ASSERT_TRUE(breaker.Allow(kLibraryNumber));
+
+  // A call allowed before the circuit opened finishes on another thread.
+  std::thread straggler([&breaker]() {
+    breaker.Record(kLibraryNumber, Error::OK);
+  });
+  straggler.join();
+  EXPECT_EQ(CircuitBreaker::HALF_OPEN, breaker.GetState(kLibraryNumber));
+
+  breaker.Record(kLibraryNumber, Error(Error::UNKNOWN, kLibraryNumber));
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.GetState(kLibraryNumber));
+}
+
+TEST(CircuitBreakerTest, CachesOneOfConcurrentErrors) {
+  FakeClock clock;
+  CircuitBreakerPolicy policy = TestPolicy();
+  policy.min_calls = 1;
+  CircuitBreaker breaker(policy, &clock);
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t <= 4; ++t) {
+    threads.emplace_back([&breaker, t]() {
+      breaker.Record(kLibraryNumber,
+                     Error(Error::UNAVAILABLE, kLibraryNumber, t, t));
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  Error error = breaker.CachedError(kLibraryNumber);
+  EXPECT_EQ(Error::UNAVAILABLE, error.CanonicalCode());
+  EXPECT_GE(error.ErrorNumber(), 1);
+  EXPECT_LE(error.ErrorNumber(), 4);
+  EXPECT_EQ(error.ErrorNumber(), error.Subcode());
+}
+
+TEST(CircuitBreakerTest, CallReturnsCachedErrorWhenOpen) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  int calls = 0;
+  auto failing = [&calls]() -> ErrorOr<int> {
+    calls++;
+    return Failure();
+  };
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_THAT(breaker.Call(kLibraryNumber, failing),
+                ErrorIs(Error::INTERNAL_ERROR));
+  }
+  EXPECT_EQ(4, calls);
+
+  EXPECT_THAT(breaker.Call(kLibraryNumber, failing),
+              ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber));
+  EXPECT_EQ(4, calls);
+}
+
+TEST(CircuitBreakerTest, CallReturnsValueWhenClosed) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  EXPECT_THAT(breaker.Call(kLibraryNumber, []() { return ErrorOr<int>(42); }),
+              IsOkAndHolds(42));
+}
+
+TEST(CircuitBreakerTest, TracksUpToMaxLibraries) {
+  FakeClock clock;
+  CircuitBreaker breaker(TestPolicy(), &clock);
+  for (int library = 0; library < CircuitBreaker::kMaxLibraries + 1;
+       ++library) {
+    for (int i = 0; i < 4; ++i) {
+      breaker.Record(library, Failure());
+    }
+  }
+  int open = 0;
+  for (int library = 0; library < CircuitBreaker::kMaxLibraries + 1;
+       ++library) {
+    if (!breaker.Allow(library)) {
+      open++;
+    }
+  }
+  EXPECT_EQ(CircuitBreaker::kMaxLibraries, open);
+}
+
+TEST(CircuitBreakerTest, CountsConcurrentCalls) {
+  FakeClock clock;
+  CircuitBreakerPolicy policy = TestPolicy();
+  policy.min_calls = 4000;
+  CircuitBreaker breaker(policy, &clock);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&breaker]() {
+      for (int i = 0; i < 1000; ++i) {
+        breaker.Record(kLibraryNumber, Failure());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.GetState(kLibraryNumber));
+}
+
+} // namespace
+} // namespace error
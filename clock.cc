@@ -0,0 +1,96 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef NATIVE_BUILD
+
+#include <chrono>
+#include <thread>
+
+#include "clock.h"
+
+#else // NATIVE_BUILD
+
+#include <Arduino.h>
+#include <Clock.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace {
+
+#ifdef NATIVE_BUILD
+
+class SteadyClock : public Clock {
+public:
+  int64_t NowMicros() override {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void SleepMicros(int64_t micros) override {
+    if (micros > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+  }
+};
+
+#else // NATIVE_BUILD
+
+// The value returned by micros() overflows after approximately 70 minutes.
+// This clock counts the overflows to provide a 64 bit monotonic time. It must
+// be called at least once per overflow period to notice every overflow.
+class ArduinoClock : public Clock {
+public:
+  ArduinoClock() : last_micros_(0), overflows_(0) {}
+
+  int64_t NowMicros() override {
+    unsigned long now = micros();
+    if (now < last_micros_) {
+      overflows_++;
+    }
+    last_micros_ = now;
+    return (overflows_ << 32) + now;
+  }
+
+  void SleepMicros(int64_t micros) override {
+    if (micros <= 0) {
+      return;
+    }
+    // delayMicroseconds() is only accurate for short delays.
+    delay(micros / 1000);
+    delayMicroseconds(micros % 1000);
+  }
+
+private:
+  unsigned long last_micros_;
+  int64_t overflows_;
+};
+
+#endif // NATIVE_BUILD
+
+} // namespace
+
+Clock::~Clock() {}
+
+Clock *SystemClock() {
+#ifdef NATIVE_BUILD
+  static SteadyClock clock;
+#else  // NATIVE_BUILD
+  static ArduinoClock clock;
+#endif // NATIVE_BUILD
+  return &clock;
+}
+
+} // namespace error
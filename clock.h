@@ -0,0 +1,48 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// An injectable monotonic clock used by the time dependent error utilities.
+#ifndef ARDUINO_ERROR_CLOCK_H
+#define ARDUINO_ERROR_CLOCK_H
+
+#include <stdint.h>
+
+namespace error {
+
+// A monotonic clock with microsecond resolution.
+//
+// Code that waits or measures time takes a Clock pointer so that tests can
+// inject a fake implementation, see testing/fake_clock.h.
+class Clock {
+public:
+  virtual ~Clock();
+
+  // Returns the current time in microseconds. The epoch is unspecified, only
+  // differences between two returned values are meaningful.
+  virtual int64_t NowMicros() = 0;
+
+  // Blocks the caller for the specified number of microseconds.
+  virtual void SleepMicros(int64_t micros) = 0;
+};
+
+// Returns the clock of the platform. In native builds (-DNATIVE_BUILD) this is
+// std::chrono::steady_clock, on the Arduino platform it is micros() extended
+// to 64 bits. The returned instance is owned by the library.
+Clock *SystemClock();
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_CLOCK_H
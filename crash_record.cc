@@ -0,0 +1,144 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#ifdef NATIVE_BUILD
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "crash_record.h"
+#include "error_mapping.h"
+
+#else // NATIVE_BUILD
+
+#include <Crash_record.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace {
+
+// Identifies a valid record, changes whenever the layout changes.
+const uint32_t kMagic = 0x45525231; // "ERR1"
+
+// The persisted representation of a CrashRecord. Fixed width fields, so the
+// layout doesn't depend on the size of int.
+struct StoredRecord {
+  uint32_t magic;
+  int32_t canonical_code;
+  int32_t library_number;
+  int32_t error_number;
+  int32_t subcode;
+  int32_t site_id;
+  uint32_t checksum;
+};
+
+uint32_t Checksum(const StoredRecord &stored) {
+  uint32_t checksum = stored.magic;
+  checksum = checksum * 31 + static_cast<uint32_t>(stored.canonical_code);
+  checksum = checksum * 31 + static_cast<uint32_t>(stored.library_number);
+  checksum = checksum * 31 + static_cast<uint32_t>(stored.error_number);
+  checksum = checksum * 31 + static_cast<uint32_t>(stored.subcode);
+  checksum = checksum * 31 + static_cast<uint32_t>(stored.site_id);
+  return checksum;
+}
+
+int crash_site = kUnspecified;
+
+#ifdef NATIVE_BUILD
+
+StoredRecord process_record;
+StoredRecord *stored_record = &process_record;
+
+#else // NATIVE_BUILD
+
+// Not initialized by the C runtime, so the content survives a reset.
+StoredRecord noinit_record __attribute__((section(".noinit")));
+StoredRecord *const stored_record = &noinit_record;
+
+#endif // NATIVE_BUILD
+
+void CrashRecordHandler(const Error &error) { WriteCrashRecord(error); }
+
+} // namespace
+
+void InstallCrashRecordHandler() { SetFatalErrorHandler(CrashRecordHandler); }
+
+void SetCrashSite(int site_id) { crash_site = site_id; }
+
+void WriteCrashRecord(const Error &error) {
+  StoredRecord stored;
+  stored.magic = kMagic;
+  stored.canonical_code = error.CanonicalCode();
+  stored.library_number = error.LibraryNumber();
+  stored.error_number = error.ErrorNumber();
+  stored.subcode = error.Subcode();
+  stored.site_id = crash_site;
+  stored.checksum = Checksum(stored);
+  *stored_record = stored;
+}
+
+bool ReadCrashRecord(CrashRecord *record) {
+  StoredRecord stored = *stored_record;
+  if (stored.magic != kMagic || stored.checksum != Checksum(stored)) {
+    return false;
+  }
+  record->error = Error(static_cast<Error::Code>(stored.canonical_code),
+                        stored.library_number, stored.error_number,
+                        stored.subcode);
+  record->site_id = stored.site_id;
+  return true;
+}
+
+void ClearCrashRecord() { stored_record->magic = 0; }
+
+#ifdef NATIVE_BUILD
+
+Error OpenCrashRecordFile(const char *path) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return FromErrno(errno);
+  }
+  if (ftruncate(fd, sizeof(StoredRecord)) != 0) {
+    int error_number = errno;
+    close(fd);
+    return FromErrno(error_number);
+  }
+  void *mapped = mmap(nullptr, sizeof(StoredRecord), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  int error_number = errno;
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return FromErrno(error_number);
+  }
+
+  CloseCrashRecordFile();
+  stored_record = static_cast<StoredRecord *>(mapped);
+  return Error::OK;
+}
+
+void CloseCrashRecordFile() {
+  if (stored_record != &process_record) {
+    munmap(stored_record, sizeof(StoredRecord));
+    stored_record = &process_record;
+  }
+}
+
+#endif // NATIVE_BUILD
+
+} // namespace error
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Persists the error that caused a fatal failure so it can be read after a
+// restart.
+#ifndef ARDUINO_ERROR_CRASH_RECORD_H
+#define ARDUINO_ERROR_CRASH_RECORD_H
+
+#ifdef NATIVE_BUILD
+
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+
+// The record of a fatal failure.
+struct CrashRecord {
+  // The error that caused the failure.
+  Error error;
+
+  // Identifies the code that was running, see SetCrashSite(). Set to
+  // kUnspecified if no site was set.
+  int site_id;
+};
+
+// Installs a fatal error handler (see SetFatalErrorHandler()) that writes the
+// crash record before ErrorOr<T>::ValueOrDie() aborts.
+//
+// On the Arduino platform the record is stored in a RAM section that isn't
+// initialized on reset, so it survives a reboot caused by a watchdog or a
+// reset button, but not a power loss. In native builds it is stored in the
+// file opened by OpenCrashRecordFile(), or in process memory if no file was
+// opened.
+void InstallCrashRecordHandler();
+
+// Identifies the code that is currently running, e.g. the phase of the main
+// loop. The site id is included in the crash records written afterwards.
+void SetCrashSite(int site_id);
+
+// Writes a crash record for the error and the current crash site. Can be
+// called directly by code that handles fatal errors on its own.
+void WriteCrashRecord(const Error &error);
+
+// Reads the crash record written before the restart. Returns false if there
+// is no valid record.
+bool ReadCrashRecord(CrashRecord *record);
+
+// Removes the crash record, so the next ReadCrashRecord() returns false until
+// another record is written.
+void ClearCrashRecord();
+
+#ifdef NATIVE_BUILD
+
+// Stores the crash records in a memory-mapped file at the provided path, so
+// they survive a restart of the process. The file is created if it doesn't
+// exist. Must be called before InstallCrashRecordHandler() is used from
+// multiple threads.
+Error OpenCrashRecordFile(const char *path);
+
+// Stops using the file and goes back to storing the records in process
+// memory.
+void CloseCrashRecordFile();
+
+#endif // NATIVE_BUILD
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_CRASH_RECORD_H
@@ -0,0 +1,132 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "crash_record.h"
+
+#include <stdlib.h>
+
+#include <string>
+
+#include "error.h"
+#include "error_or.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+
+const int kLibraryNumber = 21;
+const int kErrorNumber = 22;
+const int kSubcode = 23;
+const int kSiteId = 24;
+
+// Returns a path for a file in the test's temporary directory.
+std::string TempPath(const char *name) {
+  const char *directory = getenv("TEST_TMPDIR");
+  if (directory == nullptr) {
+    directory = "/tmp";
+  }
+  return std::string(directory) + "/" + name;
+}
+
+class CrashRecordTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    SetCrashSite(kUnspecified);
+    ClearCrashRecord();
+  }
+
+  void TearDown() override {
+    CloseCrashRecordFile();
+    SetFatalErrorHandler(nullptr);
+  }
+};
+
+TEST_F(CrashRecordTest, NoRecordByDefault) {
+  CrashRecord record;
+  EXPECT_FALSE(ReadCrashRecord(&record));
+}
+
+TEST_F(CrashRecordTest, ReadsWrittenRecord) {
+  WriteCrashRecord(
+      Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber, kSubcode));
+  CrashRecord record;
+  ASSERT_TRUE(ReadCrashRecord(&record));
+  EXPECT_THAT(record.error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber,
+                                    kErrorNumber, kSubcode));
+  EXPECT_EQ(kUnspecified, record.site_id);
+}
+
+TEST_F(CrashRecordTest, IncludesCrashSite) {
+  SetCrashSite(kSiteId);
+  WriteCrashRecord(Error::UNKNOWN);
+  CrashRecord record;
+  ASSERT_TRUE(ReadCrashRecord(&record));
+  EXPECT_EQ(kSiteId, record.site_id);
+}
+
+TEST_F(CrashRecordTest, ClearsRecord) {
+  WriteCrashRecord(Error::UNKNOWN);
+  ClearCrashRecord();
+  CrashRecord record;
+  EXPECT_FALSE(ReadCrashRecord(&record));
+}
+
+TEST_F(CrashRecordTest, PersistsRecordInFile) {
+  const std::string path = TempPath("crash_record_persists");
+  ASSERT_OK(OpenCrashRecordFile(path.c_str()));
+  ClearCrashRecord();
+  WriteCrashRecord(Error(Error::INTERNAL_ERROR, kLibraryNumber));
+  CloseCrashRecordFile();
+
+  CrashRecord record;
+  EXPECT_FALSE(ReadCrashRecord(&record));
+
+  ASSERT_OK(OpenCrashRecordFile(path.c_str()));
+  ASSERT_TRUE(ReadCrashRecord(&record));
+  EXPECT_THAT(record.error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber));
+}
+
+TEST_F(CrashRecordTest, FailsToOpenInvalidPath) {
+  EXPECT_THAT(OpenCrashRecordFile("/nonexistent/directory/file"),
+              ErrorIs(Error::NOT_FOUND));
+}
+
+TEST_F(CrashRecordTest, ValueOrDieWritesRecordBeforeDying) {
+  const std::string path = TempPath("crash_record_value_or_die");
+  ASSERT_OK(OpenCrashRecordFile(path.c_str()));
+  ClearCrashRecord();
+  InstallCrashRecordHandler();
+  SetCrashSite(kSiteId);
+
+  // Dies in a child process, the record is written into the shared file.
+  ErrorOr<int> error_or(
+      Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber, kSubcode));
+  EXPECT_DEATH(error_or.ValueOrDie(), "");
+
+  // Simulates a restart by mapping the file again.
+  CloseCrashRecordFile();
+  ASSERT_OK(OpenCrashRecordFile(path.c_str()));
+  CrashRecord record;
+  ASSERT_TRUE(ReadCrashRecord(&record));
+  EXPECT_THAT(record.error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber,
+                                    kErrorNumber, kSubcode));
+  EXPECT_EQ(kSiteId, record.site_id);
+}
+
+} // namespace
+} // namespace error
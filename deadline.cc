@@ -0,0 +1,100 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef NATIVE_BUILD
+
+#include "deadline.h"
+
+#else // NATIVE_BUILD
+
+#include <Deadline.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace {
+
+// The expiration time of deadlines that never expire.
+const int64_t kInfiniteMicros = INT64_MAX;
+
+// Returns the time budget_micros after now, saturated at kInfiniteMicros.
+int64_t ExpirationMicros(int64_t now_micros, int64_t budget_micros) {
+  if (budget_micros <= 0) {
+    return now_micros;
+  }
+  if (budget_micros >= kInfiniteMicros - now_micros) {
+    return kInfiniteMicros;
+  }
+  return now_micros + budget_micros;
+}
+
+} // namespace
+
+const int Deadline::kDefaultCheckStride;
+
+Deadline::Deadline(int64_t budget_micros)
+    : Deadline(budget_micros, SystemClock()) {}
+
+Deadline::Deadline(int64_t budget_micros, Clock *clock)
+    : Deadline(budget_micros, clock, kDefaultCheckStride) {}
+
+Deadline::Deadline(int64_t budget_micros, Clock *clock, int check_stride)
+    : Deadline(clock, ExpirationMicros(clock->NowMicros(), budget_micros),
+               check_stride) {}
+
+Deadline::Deadline(Clock *clock, int64_t expires_micros, int check_stride)
+    : clock_(clock), expires_micros_(expires_micros),
+      check_stride_(check_stride > 0 ? check_stride : 1), countdown_(1),
+      expired_(false) {}
+
+Deadline Deadline::Infinite() {
+  return Deadline(SystemClock(), kInfiniteMicros, kDefaultCheckStride);
+}
+
+Error Deadline::CheckClock() {
+  if (Expired()) {
+    // Every following Check() returns here without reading the clock.
+    countdown_ = 0;
+    return Error::DEADLINE_EXCEEDED;
+  }
+  countdown_ = expires_micros_ == kInfiniteMicros ? INT16_MAX : check_stride_;
+  return Error::OK;
+}
+
+bool Deadline::Expired() {
+  if (!expired_ && expires_micros_ != kInfiniteMicros &&
+      clock_->NowMicros() >= expires_micros_) {
+    expired_ = true;
+  }
+  return expired_;
+}
+
+int64_t Deadline::RemainingMicros() {
+  if (expires_micros_ == kInfiniteMicros) {
+    return kInfiniteMicros;
+  }
+  int64_t remaining_micros = expires_micros_ - clock_->NowMicros();
+  return remaining_micros > 0 ? remaining_micros : 0;
+}
+
+Deadline Deadline::Narrowed(int64_t budget_micros) {
+  int64_t expires_micros =
+      ExpirationMicros(clock_->NowMicros(), budget_micros);
+  if (expires_micros > expires_micros_) {
+    expires_micros = expires_micros_;
+  }
+  return Deadline(clock_, expires_micros, check_stride_);
+}
+
+} // namespace error
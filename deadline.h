@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A time budget that functions check to stop working once it is spent.
+#ifndef ARDUINO_ERROR_DEADLINE_H
+#define ARDUINO_ERROR_DEADLINE_H
+
+#include <stdint.h>
+
+#ifdef NATIVE_BUILD
+
+#include "clock.h"
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Clock.h>
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+
+// A point in time after which an operation should be abandoned.
+//
+// Check() is meant to be called from loops of long running operations and is
+// cheap enough for hot paths: it only reads the clock on every check_stride-th
+// call and otherwise decrements a counter. An expired deadline stays expired
+// without further clock reads. Expired() and RemainingMicros() always read the
+// clock.
+//
+// Deadlines are passed down to the called functions, which can narrow them for
+// their own calls, so that the whole call tree respects the budget of the
+// outermost caller.
+//
+// Example use:
+//   ErrorOr<int> SumSamples(Deadline *deadline) {
+//     int sum = 0;
+//     for (int i = 0; i < kSamples; ++i) {
+//       RETURN_IF_ERROR(deadline->Check());
+//       ASSIGN_OR_RETURN(int sample, ReadSample());
+//       sum += sample;
+//     }
+//     return sum;
+//   }
+//
+//   Deadline deadline(50000);  // 50 milliseconds.
+//   ErrorOr<int> sum = SumSamples(&deadline);
+class Deadline {
+public:
+  // The number of Check() calls per clock read used by default.
+  static const int kDefaultCheckStride = 16;
+
+  // Creates a deadline that expires budget_micros after now, a budget of zero
+  // or less has already expired. The clock isn't owned and must outlive the
+  // deadline. The SystemClock() is used if no clock is provided.
+  explicit Deadline(int64_t budget_micros);
+  Deadline(int64_t budget_micros, Clock *clock);
+  Deadline(int64_t budget_micros, Clock *clock, int check_stride);
+
+  // Returns a deadline that never expires. Its Check() never reads the clock.
+  static Deadline Infinite();
+
+  // Returns Error::DEADLINE_EXCEEDED if the deadline passed, Error::OK
+  // otherwise. Reads the clock on the first call and then on every
+  // check_stride-th call, so the expiration is noticed up to check_stride - 1
+  // calls late.
+  Error Check();
+
+  // Determines if the deadline passed.
+  bool Expired();
+
+  // Returns the number of microseconds until the deadline, zero if it passed.
+  int64_t RemainingMicros();
+
+  // Returns a deadline that expires after budget_micros or when this deadline
+  // expires, whichever comes first. Uses the clock and stride of this
+  // deadline.
+  Deadline Narrowed(int64_t budget_micros);
+
+private:
+  Deadline(Clock *clock, int64_t expires_micros, int check_stride);
+
+  // Reads the clock and resets the countdown of Check().
+  Error CheckClock();
+
+  Clock *clock_;
+  int64_t expires_micros_;
+  int check_stride_;
+  // Check() reads the clock when this reaches zero.
+  int countdown_;
+  bool expired_;
+};
+
+//
+// Implementation details of the Deadline class.
+//
+
+inline Error Deadline::Check() {
+  if (--countdown_ > 0) {
+    return Error::OK;
+  }
+  return CheckClock();
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_DEADLINE_H
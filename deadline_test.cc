@@ -0,0 +1,147 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "deadline.h"
+
+#include "error.h"
+#include "error_macros.h"
+#include "error_or.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "testing/fake_clock.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::FakeClock;
+using ::testing::error::IsOk;
+using ::testing::error::IsOkAndHolds;
+
+const int64_t kBudgetMicros = 1000;
+
+TEST(DeadlineTest, ExpiresAfterBudget) {
+  FakeClock clock;
+  Deadline deadline(kBudgetMicros, &clock);
+  EXPECT_FALSE(deadline.Expired());
+  EXPECT_EQ(kBudgetMicros, deadline.RemainingMicros());
+
+  clock.AdvanceMicros(kBudgetMicros - 1);
+  EXPECT_FALSE(deadline.Expired());
+  EXPECT_EQ(1, deadline.RemainingMicros());
+
+  clock.AdvanceMicros(1);
+  EXPECT_TRUE(deadline.Expired());
+  EXPECT_EQ(0, deadline.RemainingMicros());
+}
+
+TEST(DeadlineTest, ZeroBudgetHasExpired) {
+  FakeClock clock;
+  Deadline deadline(0, &clock);
+  EXPECT_THAT(deadline.Check(), ErrorIs(Error::DEADLINE_EXCEEDED));
+}
+
+TEST(DeadlineTest, CheckReadsClockOnFirstCall) {
+  FakeClock clock;
+  Deadline deadline(kBudgetMicros, &clock);
+  clock.AdvanceMicros(kBudgetMicros);
+  EXPECT_THAT(deadline.Check(), ErrorIs(Error::DEADLINE_EXCEEDED));
+}
+
+TEST(DeadlineTest, CheckReadsClockOnEveryStride) {
+  const int kStride = 4;
+  FakeClock clock;
+  Deadline deadline(kBudgetMicros, &clock, kStride);
+  EXPECT_OK(deadline.Check());
+  clock.AdvanceMicros(kBudgetMicros);
+
+  // The expiration is noticed on the next clock read.
+  for (int i = 1; i < kStride; ++i) {
+    EXPECT_OK(deadline.Check());
+  }
+  EXPECT_THAT(deadline.Check(), ErrorIs(Error::DEADLINE_EXCEEDED));
+  // And stays expired.
+  EXPECT_THAT(deadline.Check(), ErrorIs(Error::DEADLINE_EXCEEDED));
+  EXPECT_TRUE(deadline.Expired());
+}
+
+TEST(DeadlineTest, StaysExpired) {
+  FakeClock clock;
+  Deadline deadline(kBudgetMicros, &clock, 1);
+  clock.AdvanceMicros(kBudgetMicros);
+  EXPECT_THAT(deadline.Check(), ErrorIs(Error::DEADLINE_EXCEEDED));
+
+  // The clock isn't read again, even if it jumped back.
+  clock.AdvanceMicros(-kBudgetMicros);
+  EXPECT_THAT(deadline.Check(), ErrorIs(Error::DEADLINE_EXCEEDED));
+  EXPECT_TRUE(deadline.Expired());
+}
+
+TEST(DeadlineTest, InfiniteNeverExpires) {
+  Deadline deadline = Deadline::Infinite();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_OK(deadline.Check());
+  }
+  EXPECT_FALSE(deadline.Expired());
+  EXPECT_EQ(INT64_MAX, deadline.RemainingMicros());
+}
+
+TEST(DeadlineTest, HugeBudgetDoesNotOverflow) {
+  FakeClock clock(1000);
+  Deadline deadline(INT64_MAX, &clock);
+  clock.AdvanceMicros(INT64_MAX / 2);
+  EXPECT_FALSE(deadline.Expired());
+}
+
+TEST(DeadlineTest, NarrowedExpiresWithBudget) {
+  FakeClock clock;
+  Deadline deadline(kBudgetMicros, &clock);
+  Deadline narrowed = deadline.Narrowed(kBudgetMicros / 2);
+  clock.AdvanceMicros(kBudgetMicros / 2);
+  EXPECT_TRUE(narrowed.Expired());
+  EXPECT_FALSE(deadline.Expired());
+}
+
+TEST(DeadlineTest, NarrowedExpiresWithOuterDeadline) {
+  FakeClock clock;
+  Deadline deadline(kBudgetMicros, &clock);
+  Deadline narrowed = deadline.Narrowed(2 * kBudgetMicros);
+  EXPECT_EQ(kBudgetMicros, narrowed.RemainingMicros());
+  clock.AdvanceMicros(kBudgetMicros);
+  EXPECT_TRUE(narrowed.Expired());
+}
+
+// Sums a sample per microsecond until the deadline expires.
+ErrorOr<int> SumSamples(FakeClock *clock, Deadline *deadline, int samples) {
+  int sum = 0;
+  for (int i = 0; i < samples; ++i) {
+    RETURN_IF_ERROR(deadline->Check());
+    clock->AdvanceMicros(1);
+    sum += 1;
+  }
+  return sum;
+}
+
+TEST(DeadlineTest, AbortsFunctionsReturningErrorOr) {
+  FakeClock clock;
+  Deadline deadline(100, &clock, 1);
+  EXPECT_THAT(SumSamples(&clock, &deadline, 10), IsOkAndHolds(10));
+  EXPECT_THAT(SumSamples(&clock, &deadline, 1000).GetError(),
+              ErrorIs(Error::DEADLINE_EXCEEDED));
+  EXPECT_EQ(100, clock.NowMicros());
+}
+
+} // namespace
+} // namespace error
@@ -0,0 +1,106 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "deferred_message.h"
+
+#include <sstream>
+
+namespace error {
+
+const size_t DeferredMessage::kCapacity;
+
+DeferredMessage::DeferredMessage() : operations_(nullptr) {}
+
+DeferredMessage::DeferredMessage(const DeferredMessage &other)
+    : operations_(other.operations_) {
+  if (operations_ != nullptr) {
+    operations_->copy(&other.storage_, &storage_);
+  }
+}
+
+DeferredMessage &DeferredMessage::operator=(const DeferredMessage &other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (operations_ != nullptr) {
+    operations_->destroy(&storage_);
+    // Leaves the message empty if copying the formatter throws.
+    operations_ = nullptr;
+  }
+  if (other.operations_ != nullptr) {
+    other.operations_->copy(&other.storage_, &storage_);
+    operations_ = other.operations_;
+  }
+  return *this;
+}
+
+DeferredMessage::~DeferredMessage() {
+  if (operations_ != nullptr) {
+    operations_->destroy(&storage_);
+  }
+}
+
+bool DeferredMessage::Empty() const { return operations_ == nullptr; }
+
+void DeferredMessage::FormatTo(::std::ostream *os) const {
+  if (operations_ != nullptr) {
+    operations_->format(&storage_, os);
+  }
+}
+
+::std::string DeferredMessage::ToString() const {
+  ::std::ostringstream os;
+  FormatTo(&os);
+  return os.str();
+}
+
+ErrorWithDeferredMessage::ErrorWithDeferredMessage()
+    : ErrorWithDeferredMessage(Error(Error::OK)) {}
+
+ErrorWithDeferredMessage::ErrorWithDeferredMessage(Error error)
+    : error_(error) {}
+
+ErrorWithDeferredMessage::ErrorWithDeferredMessage(Error::Code error_code)
+    : ErrorWithDeferredMessage(Error(error_code)) {}
+
+ErrorWithDeferredMessage::ErrorWithDeferredMessage(
+    Error error, const DeferredMessage &message)
+    : error_(error), message_(message) {}
+
+ErrorWithDeferredMessage::~ErrorWithDeferredMessage() {}
+
+bool ErrorWithDeferredMessage::Ok() const { return error_.Ok(); }
+
+const Error &ErrorWithDeferredMessage::GetError() const { return error_; }
+
+const DeferredMessage &ErrorWithDeferredMessage::Message() const {
+  return message_;
+}
+
+::std::string ErrorWithDeferredMessage::ToString() const {
+  ::std::ostringstream os;
+  PrintTo(*this, &os);
+  return os.str();
+}
+
+void PrintTo(const ErrorWithDeferredMessage &error, ::std::ostream *os) {
+  PrintTo(error.GetError(), os);
+  if (!error.Message().Empty()) {
+    *os << " with message \"";
+    error.Message().FormatTo(os);
+    *os << "\"";
+  }
+}
+
+} // namespace error
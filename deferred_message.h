@@ -0,0 +1,267 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Error messages that are only formatted when printed.
+// Only available in native builds (-DNATIVE_BUILD).
+#ifndef ARDUINO_ERROR_DEFERRED_MESSAGE_H
+#define ARDUINO_ERROR_DEFERRED_MESSAGE_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include <new>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "error.h"
+
+namespace error {
+
+// A message whose formatting is deferred until it is printed.
+//
+// The message is represented by a formatter, a callable object that takes an
+// ::std::ostream* and writes the message into it. The formatter is copied by
+// value into a buffer of kCapacity bytes stored inline, so creating a deferred
+// message doesn't allocate and doesn't format anything. Formatters that don't
+// fit are rejected at compile time.
+//
+// Example use:
+//   DeferredMessage message([sensor, value](::std::ostream *os) {
+//     *os << "sensor " << sensor << " returned " << value;
+//   });
+class DeferredMessage {
+public:
+  // The maximum size of the formatter.
+  static const size_t kCapacity = 48;
+
+  // Creates an empty message.
+  DeferredMessage();
+
+  // Creates a message formatted by the provided formatter.
+  template <typename Formatter,
+            typename = typename ::std::enable_if<!::std::is_same<
+                typename ::std::decay<Formatter>::type,
+                DeferredMessage>::value>::type>
+  explicit DeferredMessage(Formatter formatter);
+
+  DeferredMessage(const DeferredMessage &other);
+  // If copying the formatter throws, the message is left empty.
+  DeferredMessage &operator=(const DeferredMessage &other);
+  ~DeferredMessage();
+
+  // Determines if the message is empty.
+  bool Empty() const;
+
+  // Formats the message into the stream. Does nothing if the message is empty.
+  void FormatTo(::std::ostream *os) const;
+
+  // Formats the message into a string.
+  ::std::string ToString() const;
+
+private:
+  // Type erased operations on the stored formatter.
+  struct Operations {
+    void (*format)(const void *formatter, ::std::ostream *os);
+    void (*copy)(const void *formatter, void *destination);
+    void (*destroy)(void *formatter);
+  };
+
+  template <typename Formatter> struct OperationsFor {
+    static void Format(const void *formatter, ::std::ostream *os);
+    static void Copy(const void *formatter, void *destination);
+    static void Destroy(void *formatter);
+    static const Operations kOperations;
+  };
+
+  const Operations *operations_;
+  typename ::std::aligned_storage<kCapacity>::type storage_;
+};
+
+// Creates a deferred message that writes the arguments into the stream one
+// after another using operator<<. The arguments are copied, character arrays
+// such as string literals included, so the message stays valid after they go
+// out of scope. Character pointers are rejected at compile time since the
+// string they point to can't be copied inline, pass a ::std::string instead.
+//
+// Example use:
+//   DeferredMessage message = MakeDeferredMessage("sensor ", sensor);
+template <typename... Args>
+DeferredMessage MakeDeferredMessage(const Args &... args);
+
+// An Error accompanied by a deferred message that describes it.
+//
+// Creating and propagating the error never formats the message, it is only
+// formatted by ToString() and when the error is printed in tests.
+class ErrorWithDeferredMessage {
+public:
+  // Creates an error with the code Error::OK and an empty message.
+  ErrorWithDeferredMessage();
+
+  // Creates an error with an empty message.
+  ErrorWithDeferredMessage(Error error);
+  ErrorWithDeferredMessage(Error::Code error_code);
+
+  // Creates an error with the provided message.
+  ErrorWithDeferredMessage(Error error, const DeferredMessage &message);
+  ~ErrorWithDeferredMessage();
+
+  // Determines if the operation succeeded.
+  bool Ok() const;
+
+  // Returns the error without the message.
+  const Error &GetError() const;
+
+  // Returns the unformatted message.
+  const DeferredMessage &Message() const;
+
+  // Formats the error and its message into a human readable string.
+  ::std::string ToString() const;
+
+private:
+  Error error_;
+  DeferredMessage message_;
+};
+
+// Prints a human readable representation of the error and its message for use
+// in tests.
+void PrintTo(const ErrorWithDeferredMessage &error, ::std::ostream *os);
+
+//
+// Implementation details of the DeferredMessage class.
+//
+
+template <typename Formatter, typename>
+inline DeferredMessage::DeferredMessage(Formatter formatter)
+    : operations_(&OperationsFor<Formatter>::kOperations) {
+  static_assert(sizeof(Formatter) <= kCapacity,
+                "the formatter doesn't fit into DeferredMessage::kCapacity");
+  static_assert(alignof(Formatter) <= alignof(decltype(storage_)),
+                "the formatter has an unsupported alignment");
+  new (&storage_) Formatter(formatter);
+}
+
+template <typename Formatter>
+void DeferredMessage::OperationsFor<Formatter>::Format(const void *formatter,
+                                                       ::std::ostream *os) {
+  (*static_cast<const Formatter *>(formatter))(os);
+}
+
+template <typename Formatter>
+void DeferredMessage::OperationsFor<Formatter>::Copy(const void *formatter,
+                                                     void *destination) {
+  new (destination) Formatter(*static_cast<const Formatter *>(formatter));
+}
+
+template <typename Formatter>
+void DeferredMessage::OperationsFor<Formatter>::Destroy(void *formatter) {
+  static_cast<Formatter *>(formatter)->~Formatter();
+}
+
+template <typename Formatter>
+const DeferredMessage::Operations
+    DeferredMessage::OperationsFor<Formatter>::kOperations = {
+        &DeferredMessage::OperationsFor<Formatter>::Format,
+        &DeferredMessage::OperationsFor<Formatter>::Copy,
+        &DeferredMessage::OperationsFor<Formatter>::Destroy,
+};
+
+namespace internal {
+
+// Writes the elements of the tuple starting at index I into the stream.
+template <size_t I, typename Tuple>
+inline typename ::std::enable_if<I == ::std::tuple_size<Tuple>::value>::type
+StreamTuple(const Tuple &, ::std::ostream *) {}
+
+template <size_t I, typename Tuple>
+inline typename ::std::enable_if<(I < ::std::tuple_size<Tuple>::value)>::type
+StreamTuple(const Tuple &tuple, ::std::ostream *os) {
+  *os << ::std::get<I>(tuple);
+  StreamTuple<I + 1>(tuple, os);
+}
+
+// A copy of a character array.
+template <size_t N> struct CharArrayCopy {
+  char chars[N];
+};
+
+template <size_t N>
+inline ::std::ostream &operator<<(::std::ostream &os,
+                                  const CharArrayCopy<N> &copy) {
+  const char *end = static_cast<const char *>(memchr(copy.chars, '\0', N));
+  return os.write(copy.chars, end == nullptr ? N : end - copy.chars);
+}
+
+// Determines how an argument of a deferred message is stored.
+template <typename T> struct DeferredArgument {
+  typedef typename ::std::decay<const T>::type Type;
+
+  static const T &Copy(const T &argument) { return argument; }
+};
+
+template <size_t N> struct DeferredArgument<char[N]> {
+  typedef CharArrayCopy<N> Type;
+
+  static Type Copy(const char (&argument)[N]) {
+    Type copy;
+    memcpy(copy.chars, argument, N);
+    return copy;
+  }
+};
+
+// Determines if the type is a pointer to characters.
+template <typename T> struct IsCharPointer : ::std::false_type {};
+
+template <typename T>
+struct IsCharPointer<T *>
+    : ::std::is_same<typename ::std::remove_cv<T>::type, char> {};
+
+// Determines if none of the types is a pointer to characters.
+template <typename... Ts> struct NoCharPointers : ::std::true_type {};
+
+template <typename T, typename... Ts>
+struct NoCharPointers<T, Ts...>
+    : ::std::integral_constant<bool, !IsCharPointer<T>::value &&
+                                         NoCharPointers<Ts...>::value> {};
+
+// A formatter that writes the captured arguments one after another.
+template <typename... Args> class StreamFormatter {
+public:
+  template <typename... Sources>
+  explicit StreamFormatter(const Sources &... sources)
+      : args_(DeferredArgument<Sources>::Copy(sources)...) {}
+
+  void operator()(::std::ostream *os) const { StreamTuple<0>(args_, os); }
+
+private:
+  ::std::tuple<Args...> args_;
+};
+
+} // namespace internal
+
+template <typename... Args>
+inline DeferredMessage MakeDeferredMessage(const Args &... args) {
+  static_assert(internal::NoCharPointers<Args...>::value,
+                "character pointers may dangle, pass a ::std::string instead");
+  return DeferredMessage(
+      internal::StreamFormatter<
+          typename internal::DeferredArgument<Args>::Type...>(args...));
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_DEFERRED_MESSAGE_H
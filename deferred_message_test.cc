@@ -0,0 +1,191 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "deferred_message.h"
+
+#include <string.h>
+
+#include <ostream>
+#include <string>
+
+#include "error.h"
+#include "error_macros.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::IsOk;
+
+// Formats the message and counts how many times it was formatted.
+class CountingFormatter {
+public:
+  CountingFormatter(int sensor, int *formatted)
+      : sensor_(sensor), formatted_(formatted) {}
+
+  void operator()(::std::ostream *os) const {
+    (*formatted_)++;
+    *os << "sensor " << sensor_;
+  }
+
+private:
+  int sensor_;
+  int *formatted_;
+};
+
+// Counts its live instances and throws when copied while *fail is set.
+class ThrowingFormatter {
+public:
+  ThrowingFormatter(int *live, const bool *fail) : live_(live), fail_(fail) {
+    (*live_)++;
+  }
+
+  ThrowingFormatter(const ThrowingFormatter &other)
+      : live_(other.live_), fail_(other.fail_) {
+    if (*fail_) {
+      throw 1;
+    }
+    (*live_)++;
+  }
+
+  ~ThrowingFormatter() { (*live_)--; }
+
+  void operator()(::std::ostream *os) const { *os << "throwing"; }
+
+private:
+  int *live_;
+  const bool *fail_;
+};
+
+TEST(DeferredMessageTest, EmptyByDefault) {
+  DeferredMessage message;
+  EXPECT_TRUE(message.Empty());
+  EXPECT_EQ("", message.ToString());
+}
+
+TEST(DeferredMessageTest, FormatsFromLambda) {
+  int sensor = 3;
+  double value = 1.5;
+  DeferredMessage message([sensor, value](::std::ostream *os) {
+    *os << "sensor " << sensor << " returned " << value;
+  });
+  EXPECT_FALSE(message.Empty());
+  EXPECT_EQ("sensor 3 returned 1.5", message.ToString());
+}
+
+TEST(DeferredMessageTest, CapturesByValue) {
+  int sensor = 3;
+  DeferredMessage message = MakeDeferredMessage("sensor ", sensor);
+  sensor = 4;
+  EXPECT_EQ("sensor 3", message.ToString());
+}
+
+DeferredMessage MakeMessageFromLocalBuffer() {
+  char name[] = "sensor";
+  return MakeDeferredMessage(name, " failed");
+}
+
+TEST(DeferredMessageTest, CopiesCharArrays) {
+  DeferredMessage message = MakeMessageFromLocalBuffer();
+  // Overwrite the stack the buffer was on.
+  char other[64];
+  memset(other, 'x', sizeof(other));
+  EXPECT_EQ('x', other[sizeof(other) - 1]);
+  EXPECT_EQ("sensor failed", message.ToString());
+}
+
+TEST(DeferredMessageTest, FormatsOnlyWhenPrinted) {
+  int formatted = 0;
+  DeferredMessage message(CountingFormatter(3, &formatted));
+  DeferredMessage copy = message;
+  EXPECT_EQ(0, formatted);
+
+  EXPECT_EQ("sensor 3", copy.ToString());
+  EXPECT_EQ(1, formatted);
+}
+
+TEST(DeferredMessageTest, CopiesAndAssigns) {
+  DeferredMessage message = MakeDeferredMessage("first ", ::std::string("x"));
+  DeferredMessage other = MakeDeferredMessage(2);
+  other = message;
+  message = DeferredMessage();
+  EXPECT_TRUE(message.Empty());
+  EXPECT_EQ("first x", other.ToString());
+}
+
+TEST(DeferredMessageTest, EmptyAfterThrowingAssignment) {
+  int live = 0;
+  bool fail = false;
+  {
+    DeferredMessage message(ThrowingFormatter(&live, &fail));
+    DeferredMessage other(ThrowingFormatter(&live, &fail));
+    EXPECT_EQ(2, live);
+
+    fail = true;
+    EXPECT_ANY_THROW(other = message);
+    EXPECT_TRUE(other.Empty());
+    EXPECT_EQ(1, live);
+  }
+  EXPECT_EQ(0, live);
+}
+
+ErrorWithDeferredMessage ReadSensor(int sensor, int *formatted) {
+  return ErrorWithDeferredMessage(
+      Error(Error::INTERNAL_ERROR, sensor),
+      DeferredMessage(CountingFormatter(sensor, formatted)));
+}
+
+ErrorWithDeferredMessage Forward(int sensor, int *formatted) {
+  RETURN_IF_ERROR(ReadSensor(sensor, formatted));
+  return Error::OK;
+}
+
+TEST(ErrorWithDeferredMessageTest, OkByDefault) {
+  ErrorWithDeferredMessage error;
+  EXPECT_THAT(error, IsOk());
+  EXPECT_TRUE(error.Message().Empty());
+}
+
+TEST(ErrorWithDeferredMessageTest, DoesNotFormatWhenPropagated) {
+  int formatted = 0;
+  ErrorWithDeferredMessage error = Forward(7, &formatted);
+  EXPECT_THAT(error, ErrorIs(Error::INTERNAL_ERROR, 7));
+  EXPECT_EQ(0, formatted);
+}
+
+TEST(ErrorWithDeferredMessageTest, FormatsWhenConvertedToString) {
+  int formatted = 0;
+  ErrorWithDeferredMessage error = Forward(7, &formatted);
+#ifdef ERROR_HOP_COUNTING
+  EXPECT_EQ("Error(Code:INTERNAL_ERROR LibraryNumber:7 Hops:1) with message "
+            "\"sensor 7\"",
+            error.ToString());
+#else // ERROR_HOP_COUNTING
+  EXPECT_EQ("Error(Code:INTERNAL_ERROR LibraryNumber:7) with message "
+            "\"sensor 7\"",
+            error.ToString());
+#endif // ERROR_HOP_COUNTING
+  EXPECT_EQ(1, formatted);
+}
+
+TEST(ErrorWithDeferredMessageTest, PrintsWithoutMessage) {
+  ErrorWithDeferredMessage error(Error::UNKNOWN);
+  EXPECT_EQ("Error(Code:UNKNOWN)", ::testing::PrintToString(error));
+}
+
+} // namespace
+} // namespace error
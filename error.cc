@@ -12,8 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdlib.h>
+
 #ifdef NATIVE_BUILD
 
+#include <chrono>
 #include <ostream>
 
 #include "error.h"
@@ -25,44 +28,62 @@
 #endif // NATIVE_BUILD
 
 namespace error {
+namespace {
+
+FatalErrorHandler fatal_error_handler = nullptr;
 
-Error::Error(Code canonical_code, int library_number, int error_number,
-             int subcode)
-    : canonical_code_(canonical_code), library_number_(library_number),
-      error_number_(error_number), subcode_(subcode) {}
+#ifdef ERROR_HOP_COUNTING
 
-Error::Error(Code canonical_code, int library_number, int error_number)
-    : Error(canonical_code, library_number, error_number, kUnspecified) {}
+// The fields of Error without hop counting.
+struct ErrorWithoutHops {
+  Error::Code canonical_code;
+  int library_number;
+  int error_number;
+  int subcode;
+#ifdef ERROR_TRACING
+  int64_t trace_nanos;
+#endif // ERROR_TRACING
+};
 
-Error::Error(Code canonical_code, int library_number)
-    : Error(canonical_code, library_number, kUnspecified, kUnspecified) {}
+static_assert(sizeof(Error) == sizeof(ErrorWithoutHops),
+              "counting hops must not change the size of Error");
 
-Error::Error(Code canonical_code)
-    : Error(canonical_code, kUnspecified, kUnspecified, kUnspecified) {}
+#endif // ERROR_HOP_COUNTING
 
-Error::Error() : Error(Error::OK, kUnspecified, kUnspecified, kUnspecified) {}
+} // namespace
 
-Error::~Error() {}
+#ifdef ERROR_HOP_COUNTING
 
-bool Error::Ok() const { return canonical_code_ == Error::OK; }
+const int Error::kMaxHops;
 
-Error::Code Error::CanonicalCode() const { return canonical_code_; }
+#endif // ERROR_HOP_COUNTING
 
-const Error &Error::GetError() const { return *this; }
+FatalErrorHandler SetFatalErrorHandler(FatalErrorHandler handler) {
+  FatalErrorHandler previous = fatal_error_handler;
+  fatal_error_handler = handler;
+  return previous;
+}
 
-int Error::LibraryNumber() const { return library_number_; }
+namespace internal {
 
-int Error::ErrorNumber() const { return error_number_; }
+void DieWithError(const Error &error) {
+  if (fatal_error_handler != nullptr) {
+    fatal_error_handler(error);
+  }
+  abort();
+}
 
-int Error::Subcode() const { return subcode_; }
+#ifdef ERROR_TRACING
 
-bool Error::operator==(const Error &other) const {
-  return (CanonicalCode() == other.CanonicalCode() &&
-          LibraryNumber() == other.LibraryNumber() &&
-          ErrorNumber() == other.ErrorNumber() && Subcode() == other.Subcode());
+int64_t TraceNow() {
+  return ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+             ::std::chrono::steady_clock::now().time_since_epoch())
+      .count();
 }
 
-bool Error::operator!=(const Error &other) const { return !(*this == other); }
+#endif // ERROR_TRACING
+
+} // namespace internal
 
 #ifdef NATIVE_BUILD
 
@@ -89,6 +110,50 @@ void PrintTo(const Error &error, ::std::ostream *os) {
     *os << "UNKNOWN";
     break;
 
+  case Error::NOT_FOUND:
+    *os << "NOT_FOUND";
+    break;
+
+  case Error::ALREADY_EXISTS:
+    *os << "ALREADY_EXISTS";
+    break;
+
+  case Error::PERMISSION_DENIED:
+    *os << "PERMISSION_DENIED";
+    break;
+
+  case Error::RESOURCE_EXHAUSTED:
+    *os << "RESOURCE_EXHAUSTED";
+    break;
+
+  case Error::FAILED_PRECONDITION:
+    *os << "FAILED_PRECONDITION";
+    break;
+
+  case Error::ABORTED:
+    *os << "ABORTED";
+    break;
+
+  case Error::OUT_OF_RANGE:
+    *os << "OUT_OF_RANGE";
+    break;
+
+  case Error::UNAVAILABLE:
+    *os << "UNAVAILABLE";
+    break;
+
+  case Error::DATA_LOSS:
+    *os << "DATA_LOSS";
+    break;
+
+  case Error::CANCELLED:
+    *os << "CANCELLED";
+    break;
+
+  case Error::DEADLINE_EXCEEDED:
+    *os << "DEADLINE_EXCEEDED";
+    break;
+
   default:
     *os << error.CanonicalCode();
     break;
@@ -103,6 +168,11 @@ void PrintTo(const Error &error, ::std::ostream *os) {
   if (error.Subcode() != kUnspecified) {
     *os << " Subcode:" << error.Subcode();
   }
+#ifdef ERROR_HOP_COUNTING
+  if (error.Hops() > 0) {
+    *os << " Hops:" << error.Hops();
+  }
+#endif // ERROR_HOP_COUNTING
   *os << ")";
 }
 
@@ -20,17 +20,46 @@
 
 #ifdef NATIVE_BUILD
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
 #include <ostream>
 
 #endif // NATIVE_BUILD
 
+#if defined(ERROR_TRACING) && !defined(NATIVE_BUILD)
+#error "ERROR_TRACING is only available in native builds (-DNATIVE_BUILD)"
+#endif
+
 namespace error {
 
 // An error number used when no error number was specified.
 const int kUnspecified = -1;
 
+#ifdef ERROR_TRACING
+
+namespace internal {
+
+// Returns the current time of a monotonic clock in nanoseconds.
+int64_t TraceNow();
+
+} // namespace internal
+
+#endif // ERROR_TRACING
+
 // An object that represents the result of an execution.
 //
+// All constructors and accessors are constexpr, so errors can be created and
+// inspected in constant expressions. When compiled with -DERROR_TRACING, errors
+// other than Error::OK read the clock when they are created, so only OK errors
+// can be created in constant expressions, see error_tracing.h.
+//
+// When compiled with -DERROR_HOP_COUNTING, errors also count how many times
+// they were returned by RETURN_IF_ERROR or ASSIGN_OR_RETURN, see Hops(). The
+// canonical code is then stored in a byte, so the count fits into the padding
+// after it and the size of Error doesn't change.
+//
 // An instance of the Error class always contains at least the canonical error
 // code which indicates the overall result of the execution.
 //
@@ -54,65 +83,302 @@ public:
     UNIMPLEMENTED,
     // An unknown error.
     UNKNOWN,
+    // The requested entity, like a file or a device, wasn't found.
+    NOT_FOUND,
+    // The entity that the operation attempted to create already exists.
+    ALREADY_EXISTS,
+    // The caller isn't allowed to execute the operation.
+    PERMISSION_DENIED,
+    // A resource, like memory, file descriptors or space in a buffer, has been
+    // exhausted.
+    RESOURCE_EXHAUSTED,
+    // The system isn't in a state required for the operation.
+    FAILED_PRECONDITION,
+    // The operation was aborted, typically due to a concurrency issue.
+    ABORTED,
+    // The operation was attempted past the valid range.
+    OUT_OF_RANGE,
+    // The service or device is currently unavailable, retrying may succeed.
+    UNAVAILABLE,
+    // Unrecoverable data loss or corruption.
+    DATA_LOSS,
+    // The operation was cancelled.
+    CANCELLED,
+    // The operation didn't complete before its deadline, see deadline.h.
+    DEADLINE_EXCEEDED,
   };
 
+#ifdef ERROR_HOP_COUNTING
+
+  // The hop count saturates at this value.
+  static const int kMaxHops = 255;
+
+#endif // ERROR_HOP_COUNTING
+
   // The default constructor creates an error with the code Error::OK.
-  Error();
+  constexpr Error();
 
   // Creates an error with the provided canonical error code.
-  Error(Code canonical_code);
+  constexpr Error(Code canonical_code);
 
   // Creates an error specifying the canonical error code and the number of the
   // library that produced the error.
-  Error(Code canonical_code, int library_number);
+  constexpr Error(Code canonical_code, int library_number);
 
   // Creates an error specifying the canonical error code, number of the
   // library that produced the error and the error number within the library.
-  Error(Code canonical_code, int library_number, int error_number);
+  constexpr Error(Code canonical_code, int library_number, int error_number);
 
   // Similar to the above, but also specifies a subcode.  This can be useful
   // for example when reporting an error dealing with a hardware component that
   // also specifies its own error codes.
-  Error(Code canonical_code, int library_number, int error_number, int subcode);
-  ~Error();
+  constexpr Error(Code canonical_code, int library_number, int error_number,
+                  int subcode);
 
   // Determines if the operation succeeded.
-  bool Ok() const;
+  constexpr bool Ok() const;
 
   // Retrieves the canonical error code represented by this object.
-  Code CanonicalCode() const;
+  constexpr Code CanonicalCode() const;
 
   // Returns itself. This is a convenience method so that Error and ErrorOr have
   // the same interface.
-  const Error &GetError() const;
+  constexpr const Error &GetError() const;
 
   // Retrieves the library number that produced this error, or kUnspecified if
   // not set.
-  int LibraryNumber() const;
+  constexpr int LibraryNumber() const;
 
   // Retrieves the error number within the library, or kUnspecified if not set.
-  int ErrorNumber() const;
+  constexpr int ErrorNumber() const;
 
   // Retrieves the error subcode code or kUnspecified if not set.
-  int Subcode() const;
+  constexpr int Subcode() const;
+
+#ifdef ERROR_TRACING
+
+  // Retrieves the time when the error was created as returned by
+  // internal::TraceNow(), or zero for Error::OK. Copies keep the time of the
+  // original error.
+  constexpr int64_t TraceNanos() const;
+
+#endif // ERROR_TRACING
+
+#ifdef ERROR_HOP_COUNTING
+
+  // Retrieves how many times the error was returned by RETURN_IF_ERROR or
+  // ASSIGN_OR_RETURN, up to kMaxHops. Copies keep the count of the original
+  // error.
+  constexpr int Hops() const;
+
+  // Increments the hop count, only called by the error macros.
+  void AddHop();
 
-  bool operator==(const Error &other) const;
-  bool operator!=(const Error &other) const;
+#endif // ERROR_HOP_COUNTING
+
+  // Compares all fields without branching on the individual fields. The
+  // creation time of traced errors and the hop count aren't compared.
+  constexpr bool operator==(const Error &other) const;
+  constexpr bool operator!=(const Error &other) const;
+
+  // Orders errors lexicographically by the canonical code, library number,
+  // error number and subcode, so errors can be sorted or used as keys of
+  // ordered containers.
+  constexpr bool operator<(const Error &other) const;
+
+#ifdef NATIVE_BUILD
+
+  // Hashes the error for Abseil hash containers. A template so that this
+  // header doesn't depend on Abseil.
+  template <typename H> friend H AbslHashValue(H state, const Error &error) {
+    return H::combine(static_cast<H &&>(state), error.CanonicalCode(),
+                      error.library_number_, error.error_number_,
+                      error.subcode_);
+  }
+
+#endif // NATIVE_BUILD
 
 private:
+#ifdef ERROR_HOP_COUNTING
+  unsigned char canonical_code_;
+  unsigned char hops_;
+#else  // ERROR_HOP_COUNTING
   Code canonical_code_;
+#endif // ERROR_HOP_COUNTING
   int library_number_;
   int error_number_;
   int subcode_;
+#ifdef ERROR_TRACING
+  int64_t trace_nanos_;
+#endif // ERROR_TRACING
 };
 
+// A function called with the offending error when ErrorOr<T>::ValueOrDie() is
+// called on an object that holds an error. The program is aborted after the
+// handler returns.
+typedef void (*FatalErrorHandler)(const Error &error);
+
+// Installs the fatal error handler and returns the previously installed one.
+// Passing nullptr uninstalls the handler. Should be called during
+// initialization, before any other thread could call ValueOrDie().
+FatalErrorHandler SetFatalErrorHandler(FatalErrorHandler handler);
+
+namespace internal {
+
+// Calls the installed fatal error handler and aborts. Kept out of line, so the
+// inlined ValueOrDie() is only a compare and a branch.
+[[noreturn]] void DieWithError(const Error &error);
+
+#ifdef ERROR_HOP_COUNTING
+
+// Counts a hop of the error held by any of the error types, whose GetError()
+// all return a reference to the held error. Only called by the error macros on
+// their own non-const copy of the error.
+template <typename T> inline void AddHop(T *error) {
+  const_cast<Error &>(error->GetError()).AddHop();
+}
+
+#endif // ERROR_HOP_COUNTING
+
+} // namespace internal
+
+//
+// Implementation details of the Error class.
+//
+
+constexpr Error::Error(Code canonical_code, int library_number,
+                       int error_number, int subcode)
+    : canonical_code_(canonical_code),
+#ifdef ERROR_HOP_COUNTING
+      hops_(0),
+#endif // ERROR_HOP_COUNTING
+      library_number_(library_number), error_number_(error_number),
+      subcode_(subcode)
+#ifdef ERROR_TRACING
+      ,
+      trace_nanos_(canonical_code == Error::OK ? 0 : internal::TraceNow())
+#endif // ERROR_TRACING
+{
+}
+
+constexpr Error::Error(Code canonical_code, int library_number,
+                       int error_number)
+    : Error(canonical_code, library_number, error_number, kUnspecified) {}
+
+constexpr Error::Error(Code canonical_code, int library_number)
+    : Error(canonical_code, library_number, kUnspecified, kUnspecified) {}
+
+constexpr Error::Error(Code canonical_code)
+    : Error(canonical_code, kUnspecified, kUnspecified, kUnspecified) {}
+
+constexpr Error::Error()
+    : Error(Error::OK, kUnspecified, kUnspecified, kUnspecified) {}
+
+constexpr bool Error::Ok() const { return canonical_code_ == Error::OK; }
+
+constexpr Error::Code Error::CanonicalCode() const {
+  return static_cast<Code>(canonical_code_);
+}
+
+constexpr const Error &Error::GetError() const { return *this; }
+
+constexpr int Error::LibraryNumber() const { return library_number_; }
+
+constexpr int Error::ErrorNumber() const { return error_number_; }
+
+constexpr int Error::Subcode() const { return subcode_; }
+
+#ifdef ERROR_TRACING
+
+constexpr int64_t Error::TraceNanos() const { return trace_nanos_; }
+
+#endif // ERROR_TRACING
+
+#ifdef ERROR_HOP_COUNTING
+
+constexpr int Error::Hops() const { return hops_; }
+
+inline void Error::AddHop() {
+  if (hops_ < kMaxHops) {
+    ++hops_;
+  }
+}
+
+#endif // ERROR_HOP_COUNTING
+
+// Folds the differences of all fields into one value, so that compilers can
+// compare the fields with vector instructions instead of four branches.
+constexpr bool Error::operator==(const Error &other) const {
+  return ((canonical_code_ ^ other.canonical_code_) |
+          (library_number_ ^ other.library_number_) |
+          (error_number_ ^ other.error_number_) |
+          (subcode_ ^ other.subcode_)) == 0;
+}
+
+constexpr bool Error::operator!=(const Error &other) const {
+  return !(*this == other);
+}
+
+constexpr bool Error::operator<(const Error &other) const {
+  return canonical_code_ != other.canonical_code_
+             ? canonical_code_ < other.canonical_code_
+             : library_number_ != other.library_number_
+                   ? library_number_ < other.library_number_
+                   : error_number_ != other.error_number_
+                         ? error_number_ < other.error_number_
+                         : subcode_ < other.subcode_;
+}
+
 #ifdef NATIVE_BUILD
 
 // Prints human readable representation of Error when running native c++ tests.
 void PrintTo(const Error &error, ::std::ostream *os);
 
-#endif
+namespace internal {
+
+constexpr uint64_t ShiftXor(uint64_t value, int shift) {
+  return value ^ (value >> shift);
+}
+
+// The finalizer of MurmurHash3, every input bit affects every output bit.
+constexpr uint64_t MixBits(uint64_t value) {
+  return ShiftXor(
+      ShiftXor(ShiftXor(value, 33) * 0xFF51AFD7ED558CCDULL, 33) *
+          0xC4CEB9FE1A85EC53ULL,
+      33);
+}
+
+constexpr uint64_t PackFields(int high, int low) {
+  return static_cast<uint64_t>(static_cast<uint32_t>(high)) << 32 |
+         static_cast<uint32_t>(low);
+}
+
+// Hashes all fields of the error.
+constexpr uint64_t HashError(const Error &error) {
+  return MixBits(
+      PackFields(error.CanonicalCode(), error.LibraryNumber()) ^
+      MixBits(PackFields(error.ErrorNumber(), error.Subcode())));
+}
+
+} // namespace internal
+
+#endif // NATIVE_BUILD
 
 } // namespace error
 
+#ifdef NATIVE_BUILD
+
+namespace std {
+
+// Allows Error to be used as the key of unordered containers.
+template <> struct hash<::error::Error> {
+  size_t operator()(const ::error::Error &error) const {
+    return static_cast<size_t>(::error::internal::HashError(error));
+  }
+};
+
+} // namespace std
+
+#endif // NATIVE_BUILD
+
 #endif // ARDUINO_ERROR_ERROR_H
@@ -0,0 +1,415 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_log_sink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <utility>
+
+#include "error_mapping.h"
+
+namespace error {
+namespace {
+
+const size_t kDefaultQueueCapacity = 1024;
+const int64_t kDefaultWriteIntervalMicros = 10000;
+
+// The maximum number of buffers passed to a single writev() call.
+#ifdef IOV_MAX
+const int kMaxBuffers = IOV_MAX;
+#else  // IOV_MAX
+const int kMaxBuffers = 16;
+#endif // IOV_MAX
+
+// Assigns unique ids to the sinks.
+::std::atomic<uint64_t> next_sink_id(1);
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+int64_t NowNanos() {
+  return ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+             ::std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t ThreadId() {
+  thread_local const uint64_t thread_id =
+      ::std::hash<::std::thread::id>()(::std::this_thread::get_id());
+  return thread_id;
+}
+
+} // namespace
+
+namespace internal {
+
+// A bounded single-producer single-consumer queue of records. The producer is
+// the thread that owns the queue, the consumer is the background thread of
+// the sink.
+class ErrorLogQueue {
+public:
+  explicit ErrorLogQueue(size_t capacity)
+      : in_use(true), closed(false), mask_(capacity - 1),
+        records_(new ErrorLogRecord[capacity]), head_(0), tail_(0) {}
+
+  // Queues the record, returns false if the queue is full. Only called by the
+  // producer.
+  bool Push(const ErrorLogRecord &record) {
+    size_t tail = tail_.load(::std::memory_order_relaxed);
+    if (tail - head_.load(::std::memory_order_acquire) > mask_) {
+      return false;
+    }
+    records_[tail & mask_] = record;
+    tail_.store(tail + 1, ::std::memory_order_release);
+    return true;
+  }
+
+  // Adds the queued records as up to two contiguous buffers, because the
+  // records can wrap around the end of the ring. Returns the number of added
+  // buffers. Only called by the consumer.
+  int Peek(struct iovec *buffers, size_t *count) const {
+    size_t head = head_.load(::std::memory_order_relaxed);
+    *count = tail_.load(::std::memory_order_acquire) - head;
+    if (*count == 0) {
+      return 0;
+    }
+    size_t start = head & mask_;
+    size_t first = ::std::min(*count, mask_ + 1 - start);
+    buffers[0].iov_base = &records_[start];
+    buffers[0].iov_len = first * sizeof(ErrorLogRecord);
+    if (first == *count) {
+      return 1;
+    }
+    buffers[1].iov_base = &records_[0];
+    buffers[1].iov_len = (*count - first) * sizeof(ErrorLogRecord);
+    return 2;
+  }
+
+  // Removes records returned by Peek(). Only called by the consumer.
+  void Pop(size_t count) {
+    head_.fetch_add(count, ::std::memory_order_release);
+  }
+
+  // Set while a thread uses the queue. The queue of a finished thread is
+  // reused by the next thread that starts logging.
+  ::std::atomic<bool> in_use;
+
+  // Set when the sink is destroyed, the queue is then removed from the cache
+  // of the thread.
+  ::std::atomic<bool> closed;
+
+private:
+  const size_t mask_;
+  ::std::unique_ptr<ErrorLogRecord[]> records_;
+  ::std::atomic<size_t> head_;
+  ::std::atomic<size_t> tail_;
+};
+
+} // namespace internal
+
+namespace {
+
+// The queues used by a thread, one per sink. Releases the queues when the
+// thread exits.
+class QueueCache {
+public:
+  ~QueueCache() {
+    for (const Entry &entry : entries_) {
+      entry.second->in_use.store(false, ::std::memory_order_release);
+    }
+  }
+
+  // Returns the queue for the sink or nullptr if there is none.
+  internal::ErrorLogQueue *Find(uint64_t sink_id) {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (entries_[i].second->closed.load(::std::memory_order_acquire)) {
+        entries_[i] = entries_.back();
+        entries_.pop_back();
+        --i;
+      } else if (entries_[i].first == sink_id) {
+        return entries_[i].second.get();
+      }
+    }
+    return nullptr;
+  }
+
+  void Add(uint64_t sink_id,
+           const ::std::shared_ptr<internal::ErrorLogQueue> &queue) {
+    entries_.push_back(Entry(sink_id, queue));
+  }
+
+private:
+  typedef ::std::pair<uint64_t, ::std::shared_ptr<internal::ErrorLogQueue>>
+      Entry;
+
+  ::std::vector<Entry> entries_;
+};
+
+thread_local QueueCache queue_cache;
+
+// Returns the queue at the offset from the first one, wrapping around.
+internal::ErrorLogQueue *
+Queue(const ::std::vector<::std::shared_ptr<internal::ErrorLogQueue>> &queues,
+      size_t first, size_t offset) {
+  return queues[(first + offset) % queues.size()].get();
+}
+
+} // namespace
+
+ErrorLogSinkPolicy::ErrorLogSinkPolicy()
+    : queue_capacity(kDefaultQueueCapacity),
+      write_interval_micros(kDefaultWriteIntervalMicros) {}
+
+ErrorLogSink::ErrorLogSink() : ErrorLogSink(ErrorLogSinkPolicy()) {}
+
+ErrorLogSink::ErrorLogSink(const ErrorLogSinkPolicy &policy)
+    : policy_(policy), id_(next_sink_id.fetch_add(1)), fd_(-1), open_(false),
+      dropped_(0), written_(0), stopping_(false), flush_requests_(0),
+      flushes_done_(0) {}
+
+ErrorLogSink::~ErrorLogSink() {
+  if (writer_.joinable()) {
+    {
+      ::std::lock_guard<::std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  for (const ::std::shared_ptr<internal::ErrorLogQueue> &queue : queues_) {
+    queue->closed.store(true, ::std::memory_order_release);
+  }
+}
+
+Error ErrorLogSink::Open(const char *path) {
+  if (fd_ >= 0) {
+    return Error::INTERNAL_ERROR;
+  }
+  fd_ = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0) {
+    return FromErrno(errno);
+  }
+  writer_ = ::std::thread(&ErrorLogSink::Run, this);
+  open_.store(true, ::std::memory_order_release);
+  return Error::OK;
+}
+
+void ErrorLogSink::Log(const Error &error) {
+  if (!open_.load(::std::memory_order_acquire)) {
+    dropped_.fetch_add(1, ::std::memory_order_relaxed);
+    return;
+  }
+  ErrorLogRecord record;
+  record.timestamp_nanos = NowNanos();
+  record.thread_id = ThreadId();
+  record.canonical_code = error.CanonicalCode();
+  record.library_number = error.LibraryNumber();
+  record.error_number = error.ErrorNumber();
+  record.subcode = error.Subcode();
+  if (!ThreadQueue()->Push(record)) {
+    dropped_.fetch_add(1, ::std::memory_order_relaxed);
+  }
+}
+
+void ErrorLogSink::Flush() {
+  if (!writer_.joinable()) {
+    return;
+  }
+  ::std::unique_lock<::std::mutex> lock(mutex_);
+  uint64_t request = ++flush_requests_;
+  wake_.notify_one();
+  flushed_.wait(lock, [this, request] { return flushes_done_ >= request; });
+}
+
+uint64_t ErrorLogSink::Dropped() const {
+  return dropped_.load(::std::memory_order_relaxed);
+}
+
+uint64_t ErrorLogSink::Written() const {
+  return written_.load(::std::memory_order_relaxed);
+}
+
+internal::ErrorLogQueue *ErrorLogSink::ThreadQueue() {
+  internal::ErrorLogQueue *queue = queue_cache.Find(id_);
+  if (queue != nullptr) {
+    return queue;
+  }
+
+  // Slow path, taken once per thread.
+  ::std::shared_ptr<internal::ErrorLogQueue> found;
+  {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    for (const ::std::shared_ptr<internal::ErrorLogQueue> &candidate :
+         queues_) {
+      bool in_use = false;
+      if (candidate->in_use.compare_exchange_strong(in_use, true)) {
+        found = candidate;
+        break;
+      }
+    }
+    if (!found) {
+      found = ::std::make_shared<internal::ErrorLogQueue>(
+          RoundUpToPowerOfTwo(policy_.queue_capacity));
+      queues_.push_back(found);
+    }
+  }
+  queue_cache.Add(id_, found);
+  return found.get();
+}
+
+void ErrorLogSink::Run() {
+  Queues queues;
+  size_t first_queue = 0;
+  ::std::unique_lock<::std::mutex> lock(mutex_);
+  while (true) {
+    bool stopping = stopping_;
+    uint64_t request = flush_requests_;
+    queues = queues_;
+    lock.unlock();
+
+    // Each queue is written once per pass, so that busy logging threads can't
+    // keep the writer from noticing a flush or stop request. The pass starts
+    // with a different queue each time, so no queue is always written last.
+    for (size_t written = 0; written < queues.size();) {
+      written += WriteQueued(queues, (first_queue + written) % queues.size(),
+                             queues.size() - written);
+    }
+    if (!queues.empty()) {
+      first_queue = (first_queue + 1) % queues.size();
+    }
+
+    lock.lock();
+    flushes_done_ = request;
+    flushed_.notify_all();
+    if (stopping) {
+      return;
+    }
+    wake_.wait_for(
+        lock, ::std::chrono::microseconds(policy_.write_interval_micros),
+        [this, request] { return stopping_ || flush_requests_ != request; });
+  }
+}
+
+size_t ErrorLogSink::WriteQueued(const Queues &queues, size_t first,
+                                 size_t count) {
+  struct iovec buffers[kMaxBuffers];
+  size_t counts[kMaxBuffers];
+  int num_buffers = 0;
+  size_t num_queues = 0;
+  size_t total = 0;
+  while (num_queues < count && num_buffers + 2 <= kMaxBuffers) {
+    num_buffers += Queue(queues, first, num_queues)
+                       ->Peek(&buffers[num_buffers], &counts[num_queues]);
+    total += counts[num_queues];
+    ++num_queues;
+  }
+  if (total == 0) {
+    return num_queues;
+  }
+
+  // Writes all buffers, resuming after partial writes.
+  struct iovec *next = buffers;
+  int remaining = num_buffers;
+  bool failed = false;
+  while (remaining > 0) {
+    ssize_t written = writev(fd_, next, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      failed = true;
+      break;
+    }
+    size_t left = static_cast<size_t>(written);
+    while (remaining > 0 && left >= next->iov_len) {
+      left -= next->iov_len;
+      ++next;
+      --remaining;
+    }
+    if (remaining > 0) {
+      next->iov_base = static_cast<char *>(next->iov_base) + left;
+      next->iov_len -= left;
+    }
+  }
+
+  // The records are removed even if the write failed, so a broken file
+  // doesn't block the logging threads forever.
+  for (size_t i = 0; i < num_queues; ++i) {
+    Queue(queues, first, i)->Pop(counts[i]);
+  }
+  if (failed) {
+    dropped_.fetch_add(total, ::std::memory_order_relaxed);
+  } else {
+    written_.fetch_add(total, ::std::memory_order_relaxed);
+  }
+  return num_queues;
+}
+
+Error ReadErrorLog(const char *path, ::std::vector<ErrorLogRecord> *records) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return FromErrno(errno);
+  }
+  records->clear();
+  ErrorLogRecord buffer[64];
+  size_t pending = 0;
+  while (true) {
+    ssize_t bytes = read(fd, reinterpret_cast<char *>(buffer) + pending,
+                         sizeof(buffer) - pending);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int error_number = errno;
+      close(fd);
+      return FromErrno(error_number);
+    }
+    if (bytes == 0) {
+      break;
+    }
+    pending += static_cast<size_t>(bytes);
+    size_t complete = pending / sizeof(ErrorLogRecord);
+    records->insert(records->end(), buffer, buffer + complete);
+    pending -= complete * sizeof(ErrorLogRecord);
+    if (pending > 0) {
+      memmove(buffer, buffer + complete, pending);
+    }
+  }
+  close(fd);
+
+  // A truncated record means the file is corrupt.
+  if (pending != 0) {
+    return Error::INTERNAL_ERROR;
+  }
+  return Error::OK;
+}
+
+} // namespace error
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Logs errors into a binary file from a background thread.
+// Only available in native builds (-DNATIVE_BUILD).
+#ifndef ARDUINO_ERROR_ERROR_LOG_SINK_H
+#define ARDUINO_ERROR_ERROR_LOG_SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+
+namespace error {
+namespace internal {
+
+class ErrorLogQueue;
+
+} // namespace internal
+
+// A single entry of the error log. The log file is a sequence of these
+// records in the byte order of the machine that wrote it.
+struct ErrorLogRecord {
+  // Nanoseconds since the Unix epoch when the error was logged.
+  int64_t timestamp_nanos;
+  // Identifies the thread that logged the error.
+  uint64_t thread_id;
+  int32_t canonical_code;
+  int32_t library_number;
+  int32_t error_number;
+  int32_t subcode;
+};
+
+static_assert(sizeof(ErrorLogRecord) == 32,
+              "ErrorLogRecord must not contain padding");
+
+// Determines the memory used by an ErrorLogSink.
+struct ErrorLogSinkPolicy {
+  // Creates a policy with the default values.
+  ErrorLogSinkPolicy();
+
+  // The number of records each logging thread can queue before further
+  // records are dropped. Rounded up to a power of two. Defaults to 1024.
+  size_t queue_capacity;
+
+  // How often the background thread writes the queued records, defaults to
+  // 10 milliseconds.
+  int64_t write_interval_micros;
+};
+
+// Logs errors into an append-only binary file without blocking the threads
+// that report them.
+//
+// Each logging thread gets its own bounded single-producer single-consumer
+// queue, so logging is wait-free and doesn't contend with other threads. A
+// background thread drains all queues in batches and appends them to the file
+// with a single writev() call. If a queue is full, the record is dropped and
+// counted in Dropped().
+//
+// Example use:
+//   ErrorLogSink sink;
+//   RETURN_IF_ERROR(sink.Open("/var/log/errors.bin"));
+//   ...
+//   sink.Log(error);
+class ErrorLogSink {
+public:
+  ErrorLogSink();
+  explicit ErrorLogSink(const ErrorLogSinkPolicy &policy);
+
+  // Writes the remaining records and stops the background thread.
+  ~ErrorLogSink();
+
+  // Opens the file for appending and starts the background thread. Errors
+  // logged before the sink is opened are dropped.
+  Error Open(const char *path);
+
+  // Queues the error to be written. Never blocks, except for the first call
+  // from each thread which registers the queue of the thread.
+  void Log(const Error &error);
+
+  // Blocks until all records queued before the call are written.
+  void Flush();
+
+  // Returns the number of records dropped because a queue was full or the
+  // file wasn't open.
+  uint64_t Dropped() const;
+
+  // Returns the number of records written into the file.
+  uint64_t Written() const;
+
+private:
+  typedef ::std::vector<::std::shared_ptr<internal::ErrorLogQueue>> Queues;
+
+  // Not copyable.
+  ErrorLogSink(const ErrorLogSink &);
+  ErrorLogSink &operator=(const ErrorLogSink &);
+
+  // Returns the queue of the calling thread, creating it if needed.
+  internal::ErrorLogQueue *ThreadQueue();
+
+  // The body of the background thread.
+  void Run();
+
+  // Writes the records queued in up to count queues, starting with the queue
+  // at index first and wrapping around. Returns the number of queues written,
+  // which is lower than count if they didn't fit into a single writev() call.
+  // Only called from the background thread.
+  size_t WriteQueued(const Queues &queues, size_t first, size_t count);
+
+  const ErrorLogSinkPolicy policy_;
+  // Distinguishes sinks in the per-thread queue caches.
+  const uint64_t id_;
+  int fd_;
+  ::std::atomic<bool> open_;
+  ::std::atomic<uint64_t> dropped_;
+  ::std::atomic<uint64_t> written_;
+
+  // Guards the fields below.
+  ::std::mutex mutex_;
+  ::std::condition_variable wake_;
+  ::std::condition_variable flushed_;
+  Queues queues_;
+  bool stopping_;
+  uint64_t flush_requests_;
+  uint64_t flushes_done_;
+
+  ::std::thread writer_;
+};
+
+// Reads all records from the log file written by an ErrorLogSink.
+Error ReadErrorLog(const char *path, ::std::vector<ErrorLogRecord> *records);
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_ERROR_LOG_SINK_H
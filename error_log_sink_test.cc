@@ -0,0 +1,219 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_log_sink.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+
+const int kLibraryNumber = 31;
+const int kErrorNumber = 32;
+const int kSubcode = 33;
+
+// Returns a path for a new file in the test's temporary directory.
+std::string TempPath(const char *name) {
+  const char *directory = getenv("TEST_TMPDIR");
+  if (directory == nullptr) {
+    directory = "/tmp";
+  }
+  std::string path = std::string(directory) + "/" + name;
+  unlink(path.c_str());
+  return path;
+}
+
+TEST(ErrorLogSinkTest, WritesLoggedErrors) {
+  const std::string path = TempPath("error_log_sink_writes");
+  {
+    ErrorLogSink sink;
+    ASSERT_OK(sink.Open(path.c_str()));
+    sink.Log(Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber,
+                   kSubcode));
+    sink.Log(Error(Error::INVALID_ARGUMENT, kLibraryNumber));
+    sink.Flush();
+    EXPECT_EQ(2u, sink.Written());
+    EXPECT_EQ(0u, sink.Dropped());
+  }
+
+  std::vector<ErrorLogRecord> records;
+  ASSERT_OK(ReadErrorLog(path.c_str(), &records));
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ(Error::INTERNAL_ERROR, records[0].canonical_code);
+  EXPECT_EQ(kLibraryNumber, records[0].library_number);
+  EXPECT_EQ(kErrorNumber, records[0].error_number);
+  EXPECT_EQ(kSubcode, records[0].subcode);
+  EXPECT_EQ(Error::INVALID_ARGUMENT, records[1].canonical_code);
+  EXPECT_EQ(records[0].thread_id, records[1].thread_id);
+  EXPECT_LE(records[0].timestamp_nanos, records[1].timestamp_nanos);
+}
+
+TEST(ErrorLogSinkTest, WritesRemainingRecordsWhenDestroyed) {
+  const std::string path = TempPath("error_log_sink_destroyed");
+  {
+    ErrorLogSink sink;
+    ASSERT_OK(sink.Open(path.c_str()));
+    for (int i = 0; i < 10; ++i) {
+      sink.Log(Error(Error::INTERNAL_ERROR, kLibraryNumber, i));
+    }
+  }
+
+  std::vector<ErrorLogRecord> records;
+  ASSERT_OK(ReadErrorLog(path.c_str(), &records));
+  ASSERT_EQ(10u, records.size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, records[i].error_number);
+  }
+}
+
+TEST(ErrorLogSinkTest, AppendsToExistingFile) {
+  const std::string path = TempPath("error_log_sink_appends");
+  for (int i = 0; i < 2; ++i) {
+    ErrorLogSink sink;
+    ASSERT_OK(sink.Open(path.c_str()));
+    sink.Log(Error(Error::INTERNAL_ERROR, kLibraryNumber, i));
+  }
+
+  std::vector<ErrorLogRecord> records;
+  ASSERT_OK(ReadErrorLog(path.c_str(), &records));
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ(0, records[0].error_number);
+  EXPECT_EQ(1, records[1].error_number);
+}
+
+TEST(ErrorLogSinkTest, DropsErrorsLoggedBeforeOpen) {
+  ErrorLogSink sink;
+  sink.Log(Error::INTERNAL_ERROR);
+  EXPECT_EQ(1u, sink.Dropped());
+  EXPECT_EQ(0u, sink.Written());
+}
+
+TEST(ErrorLogSinkTest, DropsErrorsWhenQueueIsFull) {
+  const std::string path = TempPath("error_log_sink_drops");
+  ErrorLogSinkPolicy policy;
+  policy.queue_capacity = 4;
+  // Long enough that the queue isn't drained while the test logs.
+  policy.write_interval_micros = 60 * 1000 * 1000;
+  ErrorLogSink sink(policy);
+  ASSERT_OK(sink.Open(path.c_str()));
+
+  for (int i = 0; i < 10; ++i) {
+    sink.Log(Error(Error::INTERNAL_ERROR, kLibraryNumber, i));
+  }
+  sink.Flush();
+  EXPECT_EQ(4u, sink.Written());
+  EXPECT_EQ(6u, sink.Dropped());
+}
+
+TEST(ErrorLogSinkTest, FailsToOpenInvalidPath) {
+  ErrorLogSink sink;
+  EXPECT_THAT(sink.Open("/nonexistent/directory/file"),
+              ErrorIs(Error::NOT_FOUND));
+}
+
+TEST(ErrorLogSinkTest, LogsFromMultipleThreads) {
+  const std::string path = TempPath("error_log_sink_threads");
+  const int kThreads = 4;
+  const int kErrorsPerThread = 1000;
+  ErrorLogSinkPolicy policy;
+  // Queues of finished threads are reused, so one queue may receive the
+  // records of all threads.
+  policy.queue_capacity = kThreads * kErrorsPerThread;
+  {
+    ErrorLogSink sink(policy);
+    ASSERT_OK(sink.Open(path.c_str()));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&sink, t] {
+        for (int i = 0; i < kErrorsPerThread; ++i) {
+          sink.Log(Error(Error::INTERNAL_ERROR, t, i));
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    sink.Flush();
+    EXPECT_EQ(0u, sink.Dropped());
+  }
+
+  // The records of each thread are written in order.
+  std::vector<ErrorLogRecord> records;
+  ASSERT_OK(ReadErrorLog(path.c_str(), &records));
+  ASSERT_EQ(static_cast<size_t>(kThreads * kErrorsPerThread), records.size());
+  std::vector<int> next(kThreads, 0);
+  for (const ErrorLogRecord &record : records) {
+    ASSERT_EQ(next[record.library_number], record.error_number);
+    ++next[record.library_number];
+  }
+}
+
+TEST(ErrorLogSinkTest, FlushesWhileOtherThreadsKeepLogging) {
+  const std::string path = TempPath("error_log_sink_busy");
+  ErrorLogSink sink;
+  ASSERT_OK(sink.Open(path.c_str()));
+  std::atomic<bool> stop(false);
+  std::thread logger([&sink, &stop] {
+    while (!stop.load()) {
+      sink.Log(Error(Error::INTERNAL_ERROR, kLibraryNumber));
+    }
+  });
+
+  // Each call only waits for the records queued before it.
+  sink.Log(Error(Error::INVALID_ARGUMENT, kLibraryNumber));
+  for (int i = 0; i < 10; ++i) {
+    sink.Flush();
+  }
+  EXPECT_LE(1u, sink.Written());
+  stop.store(true);
+  logger.join();
+}
+
+TEST(ErrorLogSinkTest, ReusesQueuesOfFinishedThreads) {
+  const std::string path = TempPath("error_log_sink_reuses");
+  ErrorLogSink sink;
+  ASSERT_OK(sink.Open(path.c_str()));
+  for (int i = 0; i < 3; ++i) {
+    std::thread([&sink, i] { sink.Log(Error(Error::INTERNAL_ERROR, i)); })
+        .join();
+  }
+  sink.Flush();
+  EXPECT_EQ(3u, sink.Written());
+
+  std::vector<ErrorLogRecord> records;
+  ASSERT_OK(ReadErrorLog(path.c_str(), &records));
+  ASSERT_EQ(3u, records.size());
+}
+
+TEST(ErrorLogSinkTest, FailsToReadMissingFile) {
+  std::vector<ErrorLogRecord> records;
+  EXPECT_THAT(ReadErrorLog("/nonexistent/directory/file", &records),
+              ErrorIs(Error::NOT_FOUND));
+}
+
+} // namespace
+} // namespace error
@@ -48,6 +48,7 @@
   {                                                                            \
     auto error = expression;                                                   \
     if (!error.Ok()) {                                                         \
+      COUNT_ERROR_HOP(error);                                                  \
       return error;                                                            \
     }                                                                          \
   }
@@ -77,10 +78,20 @@
 #define ASSIGN_OR_RETURN_IMPL(error_or_value, type_variable_name, expression)  \
   auto error_or_value = expression;                                            \
   if (!error_or_value.Ok()) {                                                  \
+    COUNT_ERROR_HOP(error_or_value);                                           \
     return error_or_value.GetError();                                          \
   }                                                                            \
   type_variable_name = error_or_value.ValueOrDie();
 
+// Counts the hop of an error returned by the macros when compiled with
+// -DERROR_HOP_COUNTING, see ::error::Error::Hops().
+#ifdef ERROR_HOP_COUNTING
+#define COUNT_ERROR_HOP(error_holder)                                          \
+  ::error::internal::AddHop(&error_holder)
+#else // ERROR_HOP_COUNTING
+#define COUNT_ERROR_HOP(error_holder)
+#endif // ERROR_HOP_COUNTING
+
 // Appends the number to the expression. Used to make sure that
 // multiple ASSIGN_OR_RETURN statements can be used in the same scope.
 // They declare a local variable names error_or_valueN, where N is the number.
@@ -12,9 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <functional>
+
 #include "error.h"
 #include "error_macros.h"
 #include "gmock/gmock.h"
+#include "testing/allocation_tracker.h"
 #include "testing/error_matchers.h"
 #include "gtest/gtest.h"
 
@@ -101,4 +104,60 @@ TEST(AssignOrReturnTest, ReturnsFromPredefined) {
   EXPECT_THAT(ReturnFromPredefined(Error::OK), IsOkAndHolds(kValue));
 }
 
+TEST(ErrorMacrosTest, DoNotAllocate) {
+  EXPECT_NO_ALLOCATIONS({
+    EXPECT_FALSE(ForwardWithCode(Error::INTERNAL_ERROR).Ok());
+    EXPECT_FALSE(AssignOrForwardError(Error::INTERNAL_ERROR).Ok());
+    EXPECT_FALSE(ReturnOrForwardError(Error::INTERNAL_ERROR).Ok());
+    EXPECT_TRUE(ReturnFromPredefined(Error::OK).Ok());
+  });
+}
+
+#ifdef ERROR_HOP_COUNTING
+
+// Forwards the error returned by ValueOrError() through the provided number of
+// additional callers.
+Error ForwardThrough(int callers, Error::Code code) {
+  if (callers == 0) {
+    return AssignOrForwardError(code);
+  }
+  RETURN_IF_ERROR(ForwardThrough(callers - 1, code));
+  return Error::OK;
+}
+
+TEST(HopCountingTest, NewErrorsHaveNoHops) {
+  EXPECT_EQ(0, Error(Error::INTERNAL_ERROR).Hops());
+  EXPECT_EQ(0, ValueOrError(Error::INTERNAL_ERROR).GetError().Hops());
+}
+
+TEST(HopCountingTest, CountsEachMacro) {
+  EXPECT_EQ(1, ForwardWithCode(Error::INTERNAL_ERROR).Hops());
+  EXPECT_EQ(1, AssignOrForwardError(Error::INTERNAL_ERROR).Hops());
+  EXPECT_EQ(1, ReturnOrForwardError(Error::INTERNAL_ERROR).GetError().Hops());
+  EXPECT_EQ(4, ForwardThrough(3, Error::INTERNAL_ERROR).Hops());
+}
+
+TEST(HopCountingTest, Saturates) {
+  EXPECT_EQ(Error::kMaxHops,
+            ForwardThrough(Error::kMaxHops + 10, Error::INTERNAL_ERROR).Hops());
+}
+
+TEST(HopCountingTest, DoesNotAffectComparisons) {
+  Error forwarded = ForwardThrough(2, Error::INTERNAL_ERROR);
+  Error created(Error::INTERNAL_ERROR);
+  EXPECT_EQ(created, forwarded);
+  EXPECT_FALSE(created < forwarded);
+  EXPECT_FALSE(forwarded < created);
+  EXPECT_EQ(std::hash<Error>()(created), std::hash<Error>()(forwarded));
+}
+
+TEST(HopCountingTest, PrintsHops) {
+  EXPECT_EQ("Error(Code:INTERNAL_ERROR Hops:3)",
+            ::testing::PrintToString(ForwardThrough(2, Error::INTERNAL_ERROR)));
+  EXPECT_EQ("Error(Code:INTERNAL_ERROR)",
+            ::testing::PrintToString(Error(Error::INTERNAL_ERROR)));
+}
+
+#endif // ERROR_HOP_COUNTING
+
 } // namespace
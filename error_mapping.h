@@ -0,0 +1,341 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Conversions of status codes returned by system calls and Arduino libraries
+// into error::Error.
+#ifndef ARDUINO_ERROR_ERROR_MAPPING_H
+#define ARDUINO_ERROR_ERROR_MAPPING_H
+
+#include <stdint.h>
+
+#ifdef NATIVE_BUILD
+
+#include <errno.h>
+
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+
+// Status codes returned by TwoWire::endTransmission() in the Arduino Wire
+// library.
+enum WireStatus {
+  // The transmission succeeded.
+  WIRE_SUCCESS = 0,
+  // The data didn't fit into the transmit buffer.
+  WIRE_DATA_TOO_LONG = 1,
+  // The device didn't acknowledge its address.
+  WIRE_ADDRESS_NACK = 2,
+  // The device didn't acknowledge the data.
+  WIRE_DATA_NACK = 3,
+  // Another error, like a lost bus arbitration.
+  WIRE_OTHER_ERROR = 4,
+  // The transmission timed out.
+  WIRE_TIMEOUT = 5,
+};
+
+// Converts the status returned by TwoWire::endTransmission() into an error.
+// The raw status is preserved as the subcode, unless the status indicates a
+// success. Unknown statuses are converted to Error::UNKNOWN.
+//
+// The conversion is a lookup in a table built at compile time, so it doesn't
+// branch on the status.
+//
+// Example use:
+//   Wire.beginTransmission(kSensorAddress);
+//   Wire.write(kRegister);
+//   RETURN_IF_ERROR(FromWireStatus(Wire.endTransmission(), kSensorLibrary));
+constexpr Error FromWireStatus(uint8_t status);
+constexpr Error FromWireStatus(uint8_t status, int library_number);
+
+#ifdef NATIVE_BUILD
+
+// Converts an errno value into an error. The errno value is preserved as the
+// subcode, unless it is zero which is converted to Error::OK. Unknown values
+// are converted to Error::UNKNOWN. Only available in native builds
+// (-DNATIVE_BUILD).
+//
+// Like FromWireStatus(), the conversion is a table lookup without branches.
+//
+// Example use:
+//   int fd = open(path, O_RDONLY);
+//   if (fd < 0) {
+//     return FromErrno(errno);
+//   }
+constexpr Error FromErrno(int errno_value);
+constexpr Error FromErrno(int errno_value, int library_number);
+
+// Converts the result of a system call that returns -1 and sets errno on
+// failure, like read() or write(). Non-negative results are converted to
+// Error::OK. Only available in native builds (-DNATIVE_BUILD).
+//
+// Example use:
+//   ssize_t bytes = read(fd, buffer, sizeof(buffer));
+//   RETURN_IF_ERROR(FromSyscallResult(bytes, errno));
+constexpr Error FromSyscallResult(long result, int errno_value);
+
+#endif // NATIVE_BUILD
+
+//
+// Implementation details of the conversions.
+//
+
+namespace internal {
+
+// One entry of a conversion table.
+struct CodeMapping {
+  int from;
+  Error::Code to;
+};
+
+// Returns the canonical code of the first mapping of the value, or the
+// fallback if the value isn't mapped.
+constexpr Error::Code FindCode(const CodeMapping *mappings, int size,
+                               int value, Error::Code fallback) {
+  return size == 0 ? fallback
+                   : mappings->from == value
+                         ? mappings->to
+                         : FindCode(mappings + 1, size - 1, value, fallback);
+}
+
+// Returns the largest mapped value, at least max_value.
+constexpr int MaxMappedValue(const CodeMapping *mappings, int size,
+                             int max_value) {
+  return size == 0 ? max_value
+                   : MaxMappedValue(mappings + 1, size - 1,
+                                    mappings->from > max_value ? mappings->from
+                                                               : max_value);
+}
+
+template <int... Values> struct ValueSequence {};
+
+// Defines type as ValueSequence<0, 1, ..., Size - 1>.
+template <int Size, int... Values>
+struct MakeValueSequence : MakeValueSequence<Size - 1, Size - 1, Values...> {};
+
+template <int... Values> struct MakeValueSequence<0, Values...> {
+  typedef ValueSequence<Values...> type;
+};
+
+// A dense table that converts the values 0 to Mapping::kMaxValue into
+// canonical codes. The entry after the last value holds the fallback, so that
+// out of range values can be looked up without a branch.
+//
+// Mapping must provide the constexpr function Code(int value) and the
+// constants kMaxValue and kFallback.
+template <typename Mapping, typename Sequence> struct CodeTable;
+
+template <typename Mapping, int... Values>
+class CodeTable<Mapping, ValueSequence<Values...>> {
+public:
+  static constexpr uint8_t kCodes[] = {
+      static_cast<uint8_t>(Mapping::Code(Values))...,
+      static_cast<uint8_t>(Mapping::kFallback)};
+
+  // Returns the canonical code of the value.
+  static constexpr Error::Code Lookup(int value) {
+    return static_cast<Error::Code>(
+        kCodes[Index(static_cast<unsigned>(value),
+                     static_cast<unsigned>(value) <= kMaxValue)]);
+  }
+
+private:
+  static const unsigned kMaxValue = Mapping::kMaxValue;
+
+  // Selects the value if it is in range or the index of the fallback with
+  // masks, compilers turn a conditional expression into a branch here.
+  static constexpr unsigned Index(unsigned value, bool in_range) {
+    return (value & -static_cast<unsigned>(in_range)) |
+           ((kMaxValue + 1) & (static_cast<unsigned>(in_range) - 1));
+  }
+};
+
+template <typename Mapping, int... Values>
+constexpr uint8_t CodeTable<Mapping, ValueSequence<Values...>>::kCodes[];
+
+template <typename Mapping>
+constexpr Error::Code LookupCode(int value) {
+  return CodeTable<Mapping, typename MakeValueSequence<
+                                Mapping::kMaxValue + 1>::type>::Lookup(value);
+}
+
+// Returns the error for the canonical code, the subcode is only set for
+// errors.
+constexpr Error MakeError(Error::Code canonical_code, int library_number,
+                          int subcode) {
+  return Error(canonical_code, library_number, kUnspecified,
+               canonical_code == Error::OK ? kUnspecified : subcode);
+}
+
+constexpr CodeMapping kWireMappings[] = {
+    {WIRE_SUCCESS, Error::OK},
+    {WIRE_DATA_TOO_LONG, Error::OUT_OF_RANGE},
+    {WIRE_ADDRESS_NACK, Error::NOT_FOUND},
+    {WIRE_DATA_NACK, Error::UNAVAILABLE},
+    {WIRE_OTHER_ERROR, Error::UNKNOWN},
+    {WIRE_TIMEOUT, Error::DEADLINE_EXCEEDED},
+};
+
+struct WireMapping {
+  static const int kSize = sizeof(kWireMappings) / sizeof(kWireMappings[0]);
+  static const int kMaxValue = MaxMappedValue(kWireMappings, kSize, 0);
+  static const Error::Code kFallback = Error::UNKNOWN;
+
+  static constexpr Error::Code Code(int value) {
+    return FindCode(kWireMappings, kSize, value, kFallback);
+  }
+};
+
+#ifdef NATIVE_BUILD
+
+// Follows the conventions of the canonical codes of gRPC and Abseil. Values
+// that are aliases on some platforms, like EAGAIN and EWOULDBLOCK, map to the
+// same code.
+constexpr CodeMapping kErrnoMappings[] = {
+    {0, Error::OK},
+
+    {E2BIG, Error::INVALID_ARGUMENT},
+    {EDESTADDRREQ, Error::INVALID_ARGUMENT},
+    {EDOM, Error::INVALID_ARGUMENT},
+    {EFAULT, Error::INVALID_ARGUMENT},
+    {EILSEQ, Error::INVALID_ARGUMENT},
+    {EINVAL, Error::INVALID_ARGUMENT},
+    {ENAMETOOLONG, Error::INVALID_ARGUMENT},
+    {ENOPROTOOPT, Error::INVALID_ARGUMENT},
+    {ENOTSOCK, Error::INVALID_ARGUMENT},
+    {ENOTTY, Error::INVALID_ARGUMENT},
+    {EPROTOTYPE, Error::INVALID_ARGUMENT},
+    {ESPIPE, Error::INVALID_ARGUMENT},
+
+    {EIO, Error::INTERNAL_ERROR},
+
+    {EAFNOSUPPORT, Error::UNIMPLEMENTED},
+    {ENOSYS, Error::UNIMPLEMENTED},
+    {ENOTSUP, Error::UNIMPLEMENTED},
+    {EOPNOTSUPP, Error::UNIMPLEMENTED},
+    {EPROTONOSUPPORT, Error::UNIMPLEMENTED},
+    {EXDEV, Error::UNIMPLEMENTED},
+
+    {ENODEV, Error::NOT_FOUND},
+    {ENOENT, Error::NOT_FOUND},
+    {ENXIO, Error::NOT_FOUND},
+    {ESRCH, Error::NOT_FOUND},
+
+    {EADDRNOTAVAIL, Error::ALREADY_EXISTS},
+    {EALREADY, Error::ALREADY_EXISTS},
+    {EEXIST, Error::ALREADY_EXISTS},
+
+    {EACCES, Error::PERMISSION_DENIED},
+    {EPERM, Error::PERMISSION_DENIED},
+    {EROFS, Error::PERMISSION_DENIED},
+
+    {EDQUOT, Error::RESOURCE_EXHAUSTED},
+    {EMFILE, Error::RESOURCE_EXHAUSTED},
+    {EMLINK, Error::RESOURCE_EXHAUSTED},
+    {ENFILE, Error::RESOURCE_EXHAUSTED},
+    {ENOBUFS, Error::RESOURCE_EXHAUSTED},
+    {ENOMEM, Error::RESOURCE_EXHAUSTED},
+    {ENOSPC, Error::RESOURCE_EXHAUSTED},
+
+    {EADDRINUSE, Error::FAILED_PRECONDITION},
+    {EBADF, Error::FAILED_PRECONDITION},
+    {EBUSY, Error::FAILED_PRECONDITION},
+    {ECHILD, Error::FAILED_PRECONDITION},
+    {EISCONN, Error::FAILED_PRECONDITION},
+    {EISDIR, Error::FAILED_PRECONDITION},
+    {ENOTCONN, Error::FAILED_PRECONDITION},
+    {ENOTDIR, Error::FAILED_PRECONDITION},
+    {ENOTEMPTY, Error::FAILED_PRECONDITION},
+    {EPIPE, Error::FAILED_PRECONDITION},
+    {ETXTBSY, Error::FAILED_PRECONDITION},
+
+    {EDEADLK, Error::ABORTED},
+    {ESTALE, Error::ABORTED},
+
+    {EFBIG, Error::OUT_OF_RANGE},
+    {EOVERFLOW, Error::OUT_OF_RANGE},
+    {ERANGE, Error::OUT_OF_RANGE},
+
+    {EAGAIN, Error::UNAVAILABLE},
+    {ECONNABORTED, Error::UNAVAILABLE},
+    {ECONNREFUSED, Error::UNAVAILABLE},
+    {ECONNRESET, Error::UNAVAILABLE},
+    {EHOSTUNREACH, Error::UNAVAILABLE},
+    {EINTR, Error::UNAVAILABLE},
+    {ENETDOWN, Error::UNAVAILABLE},
+    {ENETRESET, Error::UNAVAILABLE},
+    {ENETUNREACH, Error::UNAVAILABLE},
+    {ENOLCK, Error::UNAVAILABLE},
+    {EWOULDBLOCK, Error::UNAVAILABLE},
+
+    {EBADMSG, Error::DATA_LOSS},
+
+    {ECANCELED, Error::CANCELLED},
+
+    {ETIMEDOUT, Error::DEADLINE_EXCEEDED},
+};
+
+struct ErrnoMapping {
+  static const int kSize = sizeof(kErrnoMappings) / sizeof(kErrnoMappings[0]);
+  static const int kMaxValue = MaxMappedValue(kErrnoMappings, kSize, 0);
+  static const Error::Code kFallback = Error::UNKNOWN;
+
+  static constexpr Error::Code Code(int value) {
+    return FindCode(kErrnoMappings, kSize, value, kFallback);
+  }
+};
+
+#endif // NATIVE_BUILD
+
+} // namespace internal
+
+constexpr Error FromWireStatus(uint8_t status, int library_number) {
+  return internal::MakeError(
+      internal::LookupCode<internal::WireMapping>(status), library_number,
+      status);
+}
+
+constexpr Error FromWireStatus(uint8_t status) {
+  return FromWireStatus(status, kUnspecified);
+}
+
+#ifdef NATIVE_BUILD
+
+constexpr Error FromErrno(int errno_value, int library_number) {
+  return internal::MakeError(
+      internal::LookupCode<internal::ErrnoMapping>(errno_value),
+      library_number, errno_value);
+}
+
+constexpr Error FromErrno(int errno_value) {
+  return FromErrno(errno_value, kUnspecified);
+}
+
+constexpr Error FromSyscallResult(long result, int errno_value) {
+  // Masks the errno value, so that the conversion stays free of branches.
+  return FromErrno(errno_value & -static_cast<int>(result < 0));
+}
+
+#endif // NATIVE_BUILD
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_ERROR_MAPPING_H
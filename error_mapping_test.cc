@@ -0,0 +1,114 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_mapping.h"
+
+#include <errno.h>
+
+#include <sstream>
+
+#include "error.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::IsOk;
+
+const int kLibraryNumber = 71;
+
+TEST(FromErrnoTest, ConvertsZeroToOk) {
+  EXPECT_THAT(FromErrno(0), IsOk());
+  EXPECT_EQ(Error(), FromErrno(0));
+}
+
+TEST(FromErrnoTest, PreservesErrnoAsSubcode) {
+  EXPECT_THAT(FromErrno(ENOENT),
+              ErrorIs(Error::NOT_FOUND, kUnspecified, kUnspecified, ENOENT));
+  EXPECT_THAT(FromErrno(EACCES, kLibraryNumber),
+              ErrorIs(Error::PERMISSION_DENIED, kLibraryNumber, kUnspecified,
+                      EACCES));
+}
+
+TEST(FromErrnoTest, ConvertsToCanonicalCodes) {
+  EXPECT_THAT(FromErrno(EINVAL), ErrorIs(Error::INVALID_ARGUMENT));
+  EXPECT_THAT(FromErrno(EIO), ErrorIs(Error::INTERNAL_ERROR));
+  EXPECT_THAT(FromErrno(ENOSYS), ErrorIs(Error::UNIMPLEMENTED));
+  EXPECT_THAT(FromErrno(EEXIST), ErrorIs(Error::ALREADY_EXISTS));
+  EXPECT_THAT(FromErrno(ENOMEM), ErrorIs(Error::RESOURCE_EXHAUSTED));
+  EXPECT_THAT(FromErrno(EBUSY), ErrorIs(Error::FAILED_PRECONDITION));
+  EXPECT_THAT(FromErrno(EDEADLK), ErrorIs(Error::ABORTED));
+  EXPECT_THAT(FromErrno(EFBIG), ErrorIs(Error::OUT_OF_RANGE));
+  EXPECT_THAT(FromErrno(ERANGE), ErrorIs(Error::OUT_OF_RANGE));
+  EXPECT_THAT(FromErrno(EAGAIN), ErrorIs(Error::UNAVAILABLE));
+  EXPECT_THAT(FromErrno(EWOULDBLOCK), ErrorIs(Error::UNAVAILABLE));
+  EXPECT_THAT(FromErrno(EBADMSG), ErrorIs(Error::DATA_LOSS));
+  EXPECT_THAT(FromErrno(ECANCELED), ErrorIs(Error::CANCELLED));
+  EXPECT_THAT(FromErrno(ETIMEDOUT), ErrorIs(Error::DEADLINE_EXCEEDED));
+}
+
+TEST(FromErrnoTest, ConvertsUnknownValuesToUnknown) {
+  EXPECT_THAT(FromErrno(-1),
+              ErrorIs(Error::UNKNOWN, kUnspecified, kUnspecified, -1));
+  EXPECT_THAT(FromErrno(100000),
+              ErrorIs(Error::UNKNOWN, kUnspecified, kUnspecified, 100000));
+}
+
+TEST(FromSyscallResultTest, ConvertsResults) {
+  EXPECT_THAT(FromSyscallResult(0, EINTR), IsOk());
+  EXPECT_THAT(FromSyscallResult(42, EINTR), IsOk());
+  EXPECT_THAT(FromSyscallResult(-1, EINTR),
+              ErrorIs(Error::UNAVAILABLE, kUnspecified, kUnspecified, EINTR));
+}
+
+TEST(FromWireStatusTest, ConvertsStatuses) {
+  EXPECT_THAT(FromWireStatus(WIRE_SUCCESS), IsOk());
+  EXPECT_EQ(Error(), FromWireStatus(WIRE_SUCCESS));
+  EXPECT_THAT(FromWireStatus(WIRE_DATA_TOO_LONG, kLibraryNumber),
+              ErrorIs(Error::OUT_OF_RANGE, kLibraryNumber, kUnspecified,
+                      WIRE_DATA_TOO_LONG));
+  EXPECT_THAT(FromWireStatus(WIRE_ADDRESS_NACK), ErrorIs(Error::NOT_FOUND));
+  EXPECT_THAT(FromWireStatus(WIRE_DATA_NACK), ErrorIs(Error::UNAVAILABLE));
+  EXPECT_THAT(FromWireStatus(WIRE_OTHER_ERROR), ErrorIs(Error::UNKNOWN));
+  EXPECT_THAT(FromWireStatus(WIRE_TIMEOUT),
+              ErrorIs(Error::DEADLINE_EXCEEDED));
+  EXPECT_THAT(FromWireStatus(200),
+              ErrorIs(Error::UNKNOWN, kUnspecified, kUnspecified, 200));
+}
+
+// Errors other than Error::OK read the clock when they are traced, so they
+// can't be created in constant expressions.
+#ifndef ERROR_TRACING
+
+TEST(ErrorMappingTest, UsableInConstantExpressions) {
+  static_assert(FromErrno(ENOENT).CanonicalCode() == Error::NOT_FOUND,
+                "FromErrno() must be constexpr");
+  static_assert(FromWireStatus(WIRE_ADDRESS_NACK).Subcode() ==
+                    WIRE_ADDRESS_NACK,
+                "FromWireStatus() must be constexpr");
+}
+
+#endif // ERROR_TRACING
+
+TEST(ErrorMappingTest, PrintsExtendedCodes) {
+  std::ostringstream os;
+  PrintTo(FromErrno(ENOENT), &os);
+  EXPECT_EQ("Error(Code:NOT_FOUND Subcode:" + std::to_string(ENOENT) + ")",
+            os.str());
+}
+
+} // namespace
+} // namespace error
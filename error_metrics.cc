@@ -0,0 +1,281 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "error_mapping.h"
+
+namespace error {
+namespace internal {
+
+// The layout of the file. All fields are in the byte order of the machine.
+// The file starts with the header, followed by num_slots slots.
+//
+// The sequence is a seqlock around resets of the file: it is odd while Open()
+// initializes the file, and changes every time the file is reset. Records
+// don't touch it, each slot is updated with independent atomic operations.
+struct MetricsHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_slots;
+  uint32_t slot_size;
+  ::std::atomic<uint64_t> sequence;
+  ::std::atomic<uint64_t> overflows;
+  uint64_t reserved[4];
+};
+
+struct MetricsSlot {
+  // Identifies the canonical code and library number counted by the slot,
+  // zero if the slot is free.
+  ::std::atomic<uint64_t> key;
+  ::std::atomic<uint64_t> count;
+  ::std::atomic<int64_t> last_seen_nanos;
+  uint64_t reserved;
+};
+
+} // namespace internal
+
+namespace {
+
+using internal::MetricsHeader;
+using internal::MetricsSlot;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "the shared counters must be lock-free to be address-free");
+static_assert(sizeof(MetricsHeader) == 64, "unexpected header size");
+static_assert(sizeof(MetricsSlot) == 32, "unexpected slot size");
+
+const uint32_t kMagic = 0x454D5452; // "EMTR"
+const uint32_t kVersion = 1;
+
+// Set in every used key, so that no key is zero.
+const uint64_t kUsedBit = 1ULL << 63;
+
+// How many times a reader retries when the file is reset while reading, and
+// how long it waits before retrying.
+const int kMaxReadAttempts = 100;
+const useconds_t kReadRetryMicros = 1000;
+
+uint64_t MakeKey(int canonical_code, int library_number) {
+  return kUsedBit | static_cast<uint64_t>(canonical_code) << 32 |
+         static_cast<uint32_t>(library_number);
+}
+
+int SlotIndex(uint64_t key, int num_slots) {
+  return static_cast<int>((key * 0x9E3779B97F4A7C15ULL >> 32) %
+                          static_cast<uint64_t>(num_slots));
+}
+
+size_t FileSize(size_t num_slots) {
+  return sizeof(MetricsHeader) + num_slots * sizeof(MetricsSlot);
+}
+
+// Returns the time since the Unix epoch in nanoseconds for the last seen
+// stamps. Where available, this reads the coarse clock, which only returns
+// the time of the last timer tick kept by the kernel instead of reading the
+// hardware clock.
+int64_t CoarseNowNanos() {
+#ifdef CLOCK_REALTIME_COARSE
+  struct timespec now;
+  if (clock_gettime(CLOCK_REALTIME_COARSE, &now) == 0) {
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+  }
+#endif // CLOCK_REALTIME_COARSE
+  return ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+             ::std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+const int ErrorMetrics::kDefaultSlots;
+
+ErrorMetrics::ErrorMetrics()
+    : header_(nullptr), slots_(nullptr), num_slots_(0), size_(0) {}
+
+ErrorMetrics::~ErrorMetrics() { Close(); }
+
+Error ErrorMetrics::Open(const char *path) {
+  return Open(path, kDefaultSlots);
+}
+
+Error ErrorMetrics::Open(const char *path, int num_slots) {
+  if (num_slots <= 0) {
+    return Error::INVALID_ARGUMENT;
+  }
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return FromErrno(errno);
+  }
+  size_t size = FileSize(static_cast<size_t>(num_slots));
+  if (ftruncate(fd, size) != 0) {
+    int error_number = errno;
+    close(fd);
+    return FromErrno(error_number);
+  }
+  void *mapped =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int error_number = errno;
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return FromErrno(error_number);
+  }
+
+  Close();
+  header_ = static_cast<MetricsHeader *>(mapped);
+  slots_ = reinterpret_cast<MetricsSlot *>(header_ + 1);
+  num_slots_ = num_slots;
+  size_ = size;
+
+  // Readers that mapped the previous content retry until the reset is done.
+  // The sequence is set to an odd and then an even value instead of being
+  // incremented twice, so that a process that crashed in the middle of a reset
+  // doesn't leave the file with the parity inverted for good.
+  const uint64_t resetting =
+      header_->sequence.load(::std::memory_order_relaxed) | 1;
+  header_->sequence.store(resetting, ::std::memory_order_relaxed);
+  ::std::atomic_thread_fence(::std::memory_order_release);
+  header_->magic = kMagic;
+  header_->version = kVersion;
+  header_->num_slots = static_cast<uint32_t>(num_slots);
+  header_->slot_size = sizeof(MetricsSlot);
+  header_->overflows.store(0, ::std::memory_order_relaxed);
+  for (int i = 0; i < num_slots; ++i) {
+    slots_[i].key.store(0, ::std::memory_order_relaxed);
+    slots_[i].count.store(0, ::std::memory_order_relaxed);
+    slots_[i].last_seen_nanos.store(0, ::std::memory_order_relaxed);
+  }
+  header_->sequence.store(resetting + 1, ::std::memory_order_release);
+  return Error::OK;
+}
+
+void ErrorMetrics::Record(const Error &error) {
+  if (header_ == nullptr || error.Ok()) {
+    return;
+  }
+  const uint64_t key = MakeKey(error.CanonicalCode(), error.LibraryNumber());
+  const int start = SlotIndex(key, num_slots_);
+  for (int i = 0; i < num_slots_; ++i) {
+    MetricsSlot *slot = &slots_[(start + i) % num_slots_];
+    uint64_t slot_key = slot->key.load(::std::memory_order_relaxed);
+    if (slot_key == 0 && slot->key.compare_exchange_strong(
+                             slot_key, key, ::std::memory_order_relaxed)) {
+      slot_key = key;
+    }
+    // If another thread claimed the slot first, slot_key now holds its key.
+    if (slot_key == key) {
+      slot->count.fetch_add(1, ::std::memory_order_relaxed);
+      slot->last_seen_nanos.store(CoarseNowNanos(),
+                                  ::std::memory_order_relaxed);
+      return;
+    }
+  }
+  header_->overflows.fetch_add(1, ::std::memory_order_relaxed);
+}
+
+void ErrorMetrics::Close() {
+  if (header_ != nullptr) {
+    munmap(header_, size_);
+    header_ = nullptr;
+    slots_ = nullptr;
+    num_slots_ = 0;
+    size_ = 0;
+  }
+}
+
+Error ReadErrorMetrics(const char *path, ErrorMetricsSnapshot *snapshot) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return FromErrno(errno);
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    int error_number = errno;
+    close(fd);
+    return FromErrno(error_number);
+  }
+  size_t size = static_cast<size_t>(status.st_size);
+  if (size < sizeof(MetricsHeader)) {
+    close(fd);
+    return Error::INVALID_ARGUMENT;
+  }
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  int error_number = errno;
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return FromErrno(error_number);
+  }
+  const MetricsHeader *header = static_cast<const MetricsHeader *>(mapped);
+  const MetricsSlot *slots = reinterpret_cast<const MetricsSlot *>(header + 1);
+
+  Error result = Error::INTERNAL_ERROR;
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    if (attempt > 0) {
+      usleep(kReadRetryMicros);
+    }
+    uint64_t sequence = header->sequence.load(::std::memory_order_acquire);
+    if (sequence % 2 != 0) {
+      continue;
+    }
+    // The slot count is read once, so that the loop below stays within the
+    // checked bounds even if the file is reset meanwhile. The check is written
+    // as a division, so that a corrupt count can't overflow it.
+    const uint32_t num_slots = header->num_slots;
+    if (header->magic != kMagic || header->version != kVersion ||
+        header->slot_size != sizeof(MetricsSlot) || num_slots == 0 ||
+        num_slots > static_cast<uint32_t>(INT_MAX) ||
+        num_slots > (size - sizeof(MetricsHeader)) / sizeof(MetricsSlot)) {
+      result = Error::INVALID_ARGUMENT;
+      break;
+    }
+
+    snapshot->metrics.clear();
+    snapshot->overflows = header->overflows.load(::std::memory_order_relaxed);
+    for (uint32_t i = 0; i < num_slots; ++i) {
+      uint64_t key = slots[i].key.load(::std::memory_order_relaxed);
+      if (key == 0) {
+        continue;
+      }
+      ErrorMetric metric;
+      metric.canonical_code =
+          static_cast<Error::Code>((key & ~kUsedBit) >> 32);
+      metric.library_number = static_cast<int32_t>(key & 0xFFFFFFFF);
+      metric.count = slots[i].count.load(::std::memory_order_relaxed);
+      metric.last_seen_nanos =
+          slots[i].last_seen_nanos.load(::std::memory_order_relaxed);
+      snapshot->metrics.push_back(metric);
+    }
+
+    ::std::atomic_thread_fence(::std::memory_order_acquire);
+    if (header->sequence.load(::std::memory_order_relaxed) == sequence) {
+      result = Error::OK;
+      break;
+    }
+  }
+  munmap(mapped, size);
+  return result;
+}
+
+} // namespace error
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Error counters shared with other processes through a memory-mapped file.
+// Only available in native builds (-DNATIVE_BUILD).
+#ifndef ARDUINO_ERROR_ERROR_METRICS_H
+#define ARDUINO_ERROR_ERROR_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "error.h"
+
+namespace error {
+namespace internal {
+
+struct MetricsHeader;
+struct MetricsSlot;
+
+} // namespace internal
+
+// Counts errors per canonical code and library number in a memory-mapped
+// file, so that other processes can read the counts without calling into the
+// process, see ReadErrorMetrics() and tools/error_metrics_reader.
+//
+// Each (canonical code, library number) pair gets a slot holding the number
+// of occurrences and the time the error was last seen. Recording an error
+// claims its slot with a single compare-and-swap the first time, afterwards
+// it costs an atomic add, a read of the wall clock and a store. On Linux the
+// clock is CLOCK_REALTIME_COARSE, which is cheap to read but only advances
+// every few milliseconds. Record() is lock-free and can be called from any
+// thread once Open() returned.
+//
+// Errors that don't fit into the fixed number of slots are only counted in
+// the total of overflows.
+//
+// Example use:
+//   ErrorMetrics metrics;
+//   RETURN_IF_ERROR(metrics.Open("/run/my_service/error_metrics"));
+//   ...
+//   metrics.Record(error);
+class ErrorMetrics {
+public:
+  // The number of slots used by Open() without an explicit count.
+  static const int kDefaultSlots = 256;
+
+  ErrorMetrics();
+
+  // Unmaps the file, the counts stay in the file.
+  ~ErrorMetrics();
+
+  // Maps the file at the provided path, creating it if it doesn't exist, and
+  // resets all counts. Must be called before Record() is used.
+  Error Open(const char *path);
+  Error Open(const char *path, int num_slots);
+
+  // Counts an occurrence of the error. Errors with the code Error::OK and
+  // calls before Open() are ignored.
+  void Record(const Error &error);
+
+private:
+  // Not copyable.
+  ErrorMetrics(const ErrorMetrics &);
+  ErrorMetrics &operator=(const ErrorMetrics &);
+
+  void Close();
+
+  internal::MetricsHeader *header_;
+  internal::MetricsSlot *slots_;
+  int num_slots_;
+  size_t size_;
+};
+
+// The counts of one (canonical code, library number) pair.
+struct ErrorMetric {
+  Error::Code canonical_code;
+  int library_number;
+  // The number of recorded occurrences.
+  uint64_t count;
+  // Nanoseconds since the Unix epoch when the error was last recorded, with
+  // the resolution of the clock read by ErrorMetrics::Record().
+  int64_t last_seen_nanos;
+};
+
+// The content of an error metrics file.
+struct ErrorMetricsSnapshot {
+  // The counts in the order of their slots.
+  ::std::vector<ErrorMetric> metrics;
+  // The number of errors that didn't fit into any slot.
+  uint64_t overflows;
+};
+
+// Reads the error metrics file written by another process. The snapshot never
+// mixes counts from before and after the file was reset by Open(). The
+// individual counts keep increasing while they are read.
+Error ReadErrorMetrics(const char *path, ErrorMetricsSnapshot *snapshot);
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_ERROR_METRICS_H
@@ -0,0 +1,217 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_metrics.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+
+const int kLibraryNumber = 61;
+const int kOtherLibraryNumber = 62;
+
+// Returns a path for a file in the test's temporary directory.
+std::string TempPath(const char *name) {
+  const char *directory = getenv("TEST_TMPDIR");
+  if (directory == nullptr) {
+    directory = "/tmp";
+  }
+  return std::string(directory) + "/" + name;
+}
+
+// Returns the metric for the canonical code and library number, or a metric
+// with a zero count if the snapshot doesn't contain it.
+ErrorMetric Find(const ErrorMetricsSnapshot &snapshot, Error::Code code,
+                 int library_number) {
+  for (const ErrorMetric &metric : snapshot.metrics) {
+    if (metric.canonical_code == code &&
+        metric.library_number == library_number) {
+      return metric;
+    }
+  }
+  ErrorMetric none = {code, library_number, 0, 0};
+  return none;
+}
+
+TEST(ErrorMetricsTest, CountsPerCodeAndLibrary) {
+  const std::string path = TempPath("error_metrics_counts");
+  ErrorMetrics metrics;
+  ASSERT_OK(metrics.Open(path.c_str()));
+  metrics.Record(Error(Error::INTERNAL_ERROR, kLibraryNumber, 1));
+  metrics.Record(Error(Error::INTERNAL_ERROR, kLibraryNumber, 2));
+  metrics.Record(Error(Error::UNKNOWN, kLibraryNumber));
+  metrics.Record(Error(Error::INTERNAL_ERROR, kOtherLibraryNumber));
+  metrics.Record(Error(Error::INTERNAL_ERROR));
+  metrics.Record(Error::OK);
+
+  ErrorMetricsSnapshot snapshot;
+  ASSERT_OK(ReadErrorMetrics(path.c_str(), &snapshot));
+  EXPECT_EQ(4u, snapshot.metrics.size());
+  EXPECT_EQ(0u, snapshot.overflows);
+  EXPECT_EQ(2u,
+            Find(snapshot, Error::INTERNAL_ERROR, kLibraryNumber).count);
+  EXPECT_EQ(1u, Find(snapshot, Error::UNKNOWN, kLibraryNumber).count);
+  EXPECT_EQ(1u,
+            Find(snapshot, Error::INTERNAL_ERROR, kOtherLibraryNumber).count);
+  EXPECT_EQ(1u, Find(snapshot, Error::INTERNAL_ERROR, kUnspecified).count);
+  EXPECT_GT(Find(snapshot, Error::UNKNOWN, kLibraryNumber).last_seen_nanos, 0);
+}
+
+TEST(ErrorMetricsTest, IgnoresErrorsBeforeOpen) {
+  ErrorMetrics metrics;
+  metrics.Record(Error::INTERNAL_ERROR);
+}
+
+TEST(ErrorMetricsTest, CountsOverflows) {
+  const std::string path = TempPath("error_metrics_overflows");
+  ErrorMetrics metrics;
+  ASSERT_OK(metrics.Open(path.c_str(), 2));
+  metrics.Record(Error(Error::INTERNAL_ERROR, 1));
+  metrics.Record(Error(Error::INTERNAL_ERROR, 2));
+  metrics.Record(Error(Error::INTERNAL_ERROR, 3));
+  metrics.Record(Error(Error::INTERNAL_ERROR, 1));
+
+  ErrorMetricsSnapshot snapshot;
+  ASSERT_OK(ReadErrorMetrics(path.c_str(), &snapshot));
+  EXPECT_EQ(2u, snapshot.metrics.size());
+  EXPECT_EQ(1u, snapshot.overflows);
+  EXPECT_EQ(2u, Find(snapshot, Error::INTERNAL_ERROR, 1).count);
+}
+
+TEST(ErrorMetricsTest, OpenResetsCounts) {
+  const std::string path = TempPath("error_metrics_resets");
+  {
+    ErrorMetrics metrics;
+    ASSERT_OK(metrics.Open(path.c_str()));
+    metrics.Record(Error(Error::INTERNAL_ERROR, kLibraryNumber));
+  }
+
+  ErrorMetricsSnapshot snapshot;
+  ASSERT_OK(ReadErrorMetrics(path.c_str(), &snapshot));
+  EXPECT_EQ(1u, snapshot.metrics.size());
+
+  ErrorMetrics metrics;
+  ASSERT_OK(metrics.Open(path.c_str()));
+  ASSERT_OK(ReadErrorMetrics(path.c_str(), &snapshot));
+  EXPECT_TRUE(snapshot.metrics.empty());
+}
+
+// The offsets of fields in the file header, see MetricsHeader in
+// error_metrics.cc.
+const off_t kNumSlotsOffset = 8;
+const off_t kSequenceOffset = 16;
+
+// Overwrites a field of the file header.
+template <typename T>
+void WriteHeaderField(const std::string &path, off_t offset, T value) {
+  int fd = open(path.c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(static_cast<ssize_t>(sizeof(value)),
+            pwrite(fd, &value, sizeof(value), offset));
+  close(fd);
+}
+
+TEST(ErrorMetricsTest, OpenRecoversFromInterruptedReset) {
+  const std::string path = TempPath("error_metrics_interrupted");
+  {
+    ErrorMetrics metrics;
+    ASSERT_OK(metrics.Open(path.c_str()));
+  }
+  // Leaves the file as if a process crashed while resetting it.
+  WriteHeaderField<uint64_t>(path, kSequenceOffset, 7);
+
+  ErrorMetrics metrics;
+  ASSERT_OK(metrics.Open(path.c_str()));
+  metrics.Record(Error(Error::INTERNAL_ERROR, kLibraryNumber));
+  ErrorMetricsSnapshot snapshot;
+  ASSERT_OK(ReadErrorMetrics(path.c_str(), &snapshot));
+  EXPECT_EQ(1u, Find(snapshot, Error::INTERNAL_ERROR, kLibraryNumber).count);
+
+  // A later reset keeps the sequence consistent.
+  ASSERT_OK(metrics.Open(path.c_str()));
+  ASSERT_OK(ReadErrorMetrics(path.c_str(), &snapshot));
+  EXPECT_TRUE(snapshot.metrics.empty());
+}
+
+TEST(ErrorMetricsTest, RejectsCorruptSlotCount) {
+  const std::string path = TempPath("error_metrics_corrupt");
+  {
+    ErrorMetrics metrics;
+    ASSERT_OK(metrics.Open(path.c_str(), 4));
+  }
+  ErrorMetricsSnapshot snapshot;
+  const uint32_t kCorruptCounts[] = {0, 5, 0x80000001, 0xFFFFFFFF};
+  for (uint32_t num_slots : kCorruptCounts) {
+    WriteHeaderField(path, kNumSlotsOffset, num_slots);
+    EXPECT_THAT(ReadErrorMetrics(path.c_str(), &snapshot),
+                ErrorIs(Error::INVALID_ARGUMENT))
+        << num_slots;
+  }
+}
+
+TEST(ErrorMetricsTest, RejectsInvalidSlotCount) {
+  ErrorMetrics metrics;
+  EXPECT_THAT(metrics.Open(TempPath("error_metrics_invalid").c_str(), 0),
+              ErrorIs(Error::INVALID_ARGUMENT));
+}
+
+TEST(ErrorMetricsTest, FailsToReadMissingFile) {
+  ErrorMetricsSnapshot snapshot;
+  EXPECT_THAT(ReadErrorMetrics("/nonexistent/directory/file", &snapshot),
+              ErrorIs(Error::NOT_FOUND));
+}
+
+TEST(ErrorMetricsTest, CountsFromMultipleThreads) {
+  const std::string path = TempPath("error_metrics_threads");
+  const int kThreads = 4;
+  const int kErrorsPerThread = 10000;
+  ErrorMetrics metrics;
+  ASSERT_OK(metrics.Open(path.c_str()));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&metrics] {
+      for (int i = 0; i < kErrorsPerThread; ++i) {
+        metrics.Record(Error(Error::INTERNAL_ERROR, i % 8));
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  ErrorMetricsSnapshot snapshot;
+  ASSERT_OK(ReadErrorMetrics(path.c_str(), &snapshot));
+  ASSERT_EQ(8u, snapshot.metrics.size());
+  for (const ErrorMetric &metric : snapshot.metrics) {
+    EXPECT_EQ(static_cast<uint64_t>(kThreads * kErrorsPerThread / 8),
+              metric.count);
+  }
+}
+
+} // namespace
+} // namespace error
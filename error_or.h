@@ -18,14 +18,9 @@
 #ifndef ARDUINO_ERROR_ERROR_OR_H
 #define ARDUINO_ERROR_ERROR_OR_H
 
-#include <stdlib.h>
-
 #ifdef NATIVE_BUILD
 
-#include <ostream>
-
 #include "error.h"
-#include "gmock/gmock.h"
 
 #else // NATIVE_BUILD
 
@@ -34,40 +29,81 @@
 #endif // NATIVE_BUILD
 
 namespace error {
+namespace internal {
+
+// The part of ErrorOr<T> that doesn't depend on T. Kept out of the template,
+// so that programs using many ErrorOr<T> types only get one copy of the error
+// handling code.
+class ErrorOrBase {
+public:
+  // Determines if the operation succeeded, in which case this object holds the
+  // promised return value.
+  constexpr bool Ok() const;
+
+  // Returns the error stored in this object.
+  constexpr const Error &GetError() const;
+
+protected:
+  // Holds Error::OK, used when the derived object holds a value.
+  constexpr ErrorOrBase();
+
+  // Holds the provided error. Error::OK is replaced with Error::UNKNOWN.
+  constexpr explicit ErrorOrBase(Error error);
+
+  // Passes the error to the fatal error handler and dies.
+  [[noreturn]] void Die() const;
+
+private:
+  Error error_;
+};
+
+} // namespace internal
 
 // An object that exclusively holds either an error code, or the return value.
-template <typename T> class ErrorOr {
+//
+// If T is a literal type, ErrorOr<T> can be used in constexpr functions. A
+// call to ValueOrDie() on an ErrorOr<T> holding an error isn't a constant
+// expression, so using it to initialize a constexpr variable fails to compile.
+//
+// Ok() and GetError() are inherited from internal::ErrorOrBase, only the
+// storage and the accessors of the value are generated for each T.
+template <typename T> class ErrorOr : public internal::ErrorOrBase {
 public:
   // Creates an ErrorOr instance that will hold the provided error and no value.
   // If the provided Error holds canonical Error::OK, it will be changed to
   // Error::UNKNOWN to keep the guarantee that this objects holds either an
   // error or a value.
-  ErrorOr(Error error);
-  ErrorOr(Error::Code error_code);
+  constexpr ErrorOr(Error error);
+  constexpr ErrorOr(Error::Code error_code);
 
   // Creates an ErrorOr instance with the canonical error code Error::UNKNOWN.
-  ErrorOr();
+  constexpr ErrorOr();
 
   // Creates an ErrorOr instance with the provided value.
   // When created using this constructor, calls to Ok() will return true and
   // calls to GetError() will return an error with the canonical code Error::OK.
   // Calls to ValueOrDie() will return the value.
-  ErrorOr(T value);
-  ~ErrorOr();
+  constexpr ErrorOr(T value);
 
-  // Determines if the operation succeeded, in which case this object holds the
-  // promised return value.
-  bool Ok() const;
+  // Returns the value or dies if called when the object contains an error.
+  // Before dying, the error is passed to the handler installed by
+  // SetFatalErrorHandler().
+  constexpr const T &ValueOrDie() const &;
+  T &ValueOrDie() &;
 
-  // Returns the error stored in this object.
-  const Error &GetError() const;
+  // Calls on const temporaries return the value without moving it.
+  constexpr const T &ValueOrDie() const &&;
 
-  // Returns the value or dies if called when the object contains an error.
-  const T &ValueOrDie() const;
-  T &ValueOrDie();
+#if __cplusplus >= 201402L
+
+  // Moves the value out of a temporary, so that T can be move-only. Only
+  // available since C++14, a constexpr member function can't modify the object
+  // in C++11. Calls on temporaries use the const overload there.
+  constexpr T &&ValueOrDie() &&;
+
+#endif // __cplusplus >= 201402L
 
 private:
-  Error error_;
   T value_;
 };
 
@@ -75,59 +111,63 @@ private:
 // Implementation details of the ErrorOr class.
 //
 
-template <typename T> inline ErrorOr<T>::ErrorOr(Error error) : error_(error) {
-  if (error_.Ok()) {
-    error_ = Error(Error::UNKNOWN);
-  }
-}
+namespace internal {
+
+constexpr ErrorOrBase::ErrorOrBase() : error_(Error::OK) {}
+
+constexpr ErrorOrBase::ErrorOrBase(Error error)
+    : error_(error.Ok() ? Error(Error::UNKNOWN) : error) {}
+
+constexpr bool ErrorOrBase::Ok() const { return error_.Ok(); }
+
+constexpr const Error &ErrorOrBase::GetError() const { return error_; }
+
+inline void ErrorOrBase::Die() const { DieWithError(error_); }
 
-template <typename T> inline ErrorOr<T>::ErrorOr() : ErrorOr(Error::UNKNOWN) {}
+} // namespace internal
 
 template <typename T>
-inline ErrorOr<T>::ErrorOr(Error::Code error_code)
-    : ErrorOr(Error(error_code)) {}
+constexpr ErrorOr<T>::ErrorOr(Error error) : ErrorOrBase(error), value_() {}
 
 template <typename T>
-inline ErrorOr<T>::ErrorOr(T value) : error_(Error(Error::OK)), value_(value) {}
+constexpr ErrorOr<T>::ErrorOr() : ErrorOr(Error::UNKNOWN) {}
 
-template <typename T> inline ErrorOr<T>::~ErrorOr() {}
+template <typename T>
+constexpr ErrorOr<T>::ErrorOr(Error::Code error_code)
+    : ErrorOr(Error(error_code)) {}
 
-template <typename T> inline bool ErrorOr<T>::Ok() const { return error_.Ok(); }
+// Moves the value, so that T can be move-only. The cast is std::move(), which
+// isn't available on the Arduino platform.
+template <typename T>
+constexpr ErrorOr<T>::ErrorOr(T value)
+    : ErrorOrBase(), value_(static_cast<T &&>(value)) {}
 
-template <typename T> inline const Error &ErrorOr<T>::GetError() const {
-  return error_;
+// Written as a single return statement to satisfy the C++11 constexpr rules.
+template <typename T> constexpr const T &ErrorOr<T>::ValueOrDie() const & {
+  return Ok() ? value_ : (Die(), value_);
 }
 
-template <typename T> inline const T &ErrorOr<T>::ValueOrDie() const {
+template <typename T> inline T &ErrorOr<T>::ValueOrDie() & {
   if (!Ok()) {
-    abort();
+    Die();
   }
   return value_;
 }
 
-template <typename T> inline T &ErrorOr<T>::ValueOrDie() {
-  if (!Ok()) {
-    abort();
-  }
-  return value_;
+template <typename T> constexpr const T &ErrorOr<T>::ValueOrDie() const && {
+  return Ok() ? value_ : (Die(), value_);
 }
 
-#ifdef NATIVE_BUILD
+#if __cplusplus >= 201402L
 
-// Prints a human readable representation of ErrorOr for use in tests.
-template <typename T>
-void PrintTo(const ErrorOr<T> &error_or, ::std::ostream *os) {
-  *os << "ErrorOr<T>(";
-  if (error_or.Ok()) {
-    *os << "with value " << testing::PrintToString(error_or.ValueOrDie())
-        << ")";
-  } else {
-    *os << "with error " << testing::PrintToString(error_or.GetError());
-    *os << ")";
+template <typename T> constexpr T &&ErrorOr<T>::ValueOrDie() && {
+  if (!Ok()) {
+    Die();
   }
+  return static_cast<T &&>(value_);
 }
 
-#endif
+#endif // __cplusplus >= 201402L
 
 } // namespace
 
@@ -13,6 +13,14 @@
 // limitations under the License.
 
 #include "error_or.h"
+
+#include <stdio.h>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "testing/allocation_tracker.h"
 #include "gtest/gtest.h"
 
 namespace error {
@@ -68,5 +76,102 @@ TEST(ErrorOrTest, ReturnsTheContainedValueByReference) {
   EXPECT_EQ(kReturnValue, value);
 }
 
+TEST(ErrorOrTest, DoesNotMoveOutOfConstTemporaries) {
+  const ErrorOr<int> error_or_int = Value();
+  static_assert(
+      ::std::is_same<decltype(::std::move(error_or_int).ValueOrDie()),
+                     const int &>::value,
+      "const temporaries must not be moved from");
+  EXPECT_EQ(kReturnValue, ::std::move(error_or_int).ValueOrDie());
+}
+
+#if __cplusplus >= 201402L
+
+ErrorOr<::std::unique_ptr<int> > MoveOnlyValue() {
+  return ::std::unique_ptr<int>(new int(kReturnValue));
+}
+
+TEST(ErrorOrTest, MovesTheValueOutOfTemporaries) {
+  ::std::unique_ptr<int> value = MoveOnlyValue().ValueOrDie();
+  ASSERT_NE(nullptr, value);
+  EXPECT_EQ(kReturnValue, *value);
+}
+
+#endif // __cplusplus >= 201402L
+
+// Large enough that a copy with a heap allocation would be tempting.
+struct Samples {
+  int values[256];
+};
+
+TEST(ErrorOrTest, DoesNotAllocate) {
+  EXPECT_NO_ALLOCATIONS({
+    ErrorOr<int> error_or_int = Value();
+    ErrorOr<int> copy = error_or_int;
+    EXPECT_EQ(kReturnValue, copy.ValueOrDie());
+    EXPECT_FALSE(InternalError().Ok());
+
+    Samples samples = {{1, 2, 3}};
+    ErrorOr<Samples> error_or_samples = samples;
+    EXPECT_EQ(2, error_or_samples.ValueOrDie().values[1]);
+  });
+}
+
+TEST(ErrorOrTest, DiesWhenHoldingError) {
+  ErrorOr<int> error_or_int = InternalError();
+  EXPECT_DEATH(error_or_int.ValueOrDie(), "");
+}
+
+void PrintingHandler(const Error &error) {
+  fprintf(stderr, "fatal error with code %d\n", error.CanonicalCode());
+}
+
+TEST(ErrorOrTest, CallsFatalErrorHandlerBeforeDying) {
+  FatalErrorHandler previous = SetFatalErrorHandler(PrintingHandler);
+  EXPECT_EQ(nullptr, previous);
+
+  const ErrorOr<int> error_or_int = InternalError();
+  EXPECT_DEATH(error_or_int.ValueOrDie(), "fatal error with code 2");
+  EXPECT_EQ(PrintingHandler, SetFatalErrorHandler(nullptr));
+}
+
+const int kMaxPin = 19;
+
+// A validation function evaluated at compile time.
+constexpr ErrorOr<int> ValidatePin(int pin) {
+  return (pin >= 0 && pin <= kMaxPin) ? ErrorOr<int>(pin)
+                                      : ErrorOr<int>(Error::INVALID_ARGUMENT);
+}
+
+struct PinMap {
+  int led;
+  int button;
+};
+
+// A table that would fail to compile if any of the pins were invalid.
+constexpr PinMap kPinMap = {ValidatePin(13).ValueOrDie(),
+                            ValidatePin(2).ValueOrDie()};
+
+// Errors other than Error::OK read the clock when they are traced, so they
+// can't be created in constant expressions.
+#ifndef ERROR_TRACING
+
+TEST(ErrorOrTest, UsableInConstantExpressions) {
+  static_assert(ValidatePin(13).Ok(), "pin must be valid");
+  static_assert(ValidatePin(13).ValueOrDie() == 13, "unexpected value");
+  static_assert(!ValidatePin(42).Ok(), "pin must be invalid");
+  static_assert(ValidatePin(42).GetError().CanonicalCode() ==
+                    Error::INVALID_ARGUMENT,
+                "unexpected canonical code");
+  static_assert(!ErrorOr<int>(Error::OK).Ok(), "OK must become UNKNOWN");
+  static_assert(ErrorOr<int>(Error::OK).GetError().CanonicalCode() ==
+                    Error::UNKNOWN,
+                "OK must become UNKNOWN");
+  static_assert(kPinMap.led == 13 && kPinMap.button == 2,
+                "unexpected pin map");
+}
+
+#endif // ERROR_TRACING
+
 } // namespace
 } // namespace error
@@ -0,0 +1,175 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef NATIVE_BUILD
+
+#include "error_reporter.h"
+
+#else // NATIVE_BUILD
+
+#include <Error_reporter.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace {
+
+const int64_t kDefaultSummaryIntervalMicros = 1000000;
+const int kDefaultBurst = 10;
+const int64_t kDefaultTokenIntervalMicros = 100000;
+
+const uint32_t kMaxPending = 0xFFFFFFFF;
+
+// Mixes all fields of the error into a slot index.
+int SlotIndex(const Error &error, int num_slots) {
+  uint32_t hash = static_cast<uint32_t>(error.CanonicalCode());
+  hash = hash * 31 + static_cast<uint32_t>(error.LibraryNumber());
+  hash = hash * 31 + static_cast<uint32_t>(error.ErrorNumber());
+  hash = hash * 31 + static_cast<uint32_t>(error.Subcode());
+  hash ^= hash >> 16;
+  return static_cast<int>(hash % static_cast<uint32_t>(num_slots));
+}
+
+} // namespace
+
+ErrorReporterPolicy::ErrorReporterPolicy()
+    : summary_interval_micros(kDefaultSummaryIntervalMicros),
+      burst(kDefaultBurst), token_interval_micros(kDefaultTokenIntervalMicros) {
+}
+
+namespace internal {
+
+ErrorReporterCore::ErrorReporterCore(const ErrorReporterPolicy &policy,
+                                     ErrorReportHandler handler, Clock *clock,
+                                     ReporterSlot *slots, int num_slots)
+    : policy_(policy), handler_(handler), clock_(clock), slots_(slots),
+      num_slots_(num_slots), tokens_(policy.burst),
+      refilled_micros_(clock->NowMicros()), dropped_(0) {}
+
+void ErrorReporterCore::Report(const Error &error) {
+  if (error.Ok()) {
+    return;
+  }
+#ifdef NATIVE_BUILD
+  ::std::lock_guard<::std::mutex> lock(mutex_);
+#endif // NATIVE_BUILD
+  int64_t now = clock_->NowMicros();
+  int start = SlotIndex(error, num_slots_);
+  ReporterSlot *slot = Find(error, start);
+  if (slot != nullptr) {
+    if (slot->pending != kMaxPending) {
+      ++slot->pending;
+    }
+    if (now - slot->reported_micros >= policy_.summary_interval_micros) {
+      Emit(slot, now);
+    }
+    return;
+  }
+
+  slot = Claim(start, now);
+  slot->error = error;
+  slot->used = true;
+  slot->pending = 1;
+  slot->reported_micros = now;
+  Emit(slot, now);
+}
+
+void ErrorReporterCore::Poll() {
+#ifdef NATIVE_BUILD
+  ::std::lock_guard<::std::mutex> lock(mutex_);
+#endif // NATIVE_BUILD
+  int64_t now = clock_->NowMicros();
+  for (int i = 0; i < num_slots_; ++i) {
+    ReporterSlot *slot = &slots_[i];
+    if (slot->used && slot->pending > 0 &&
+        now - slot->reported_micros >= policy_.summary_interval_micros) {
+      Emit(slot, now);
+    }
+  }
+}
+
+uint32_t ErrorReporterCore::Dropped() const {
+#ifdef NATIVE_BUILD
+  ::std::lock_guard<::std::mutex> lock(mutex_);
+#endif // NATIVE_BUILD
+  return dropped_;
+}
+
+ReporterSlot *ErrorReporterCore::Find(const Error &error, int start) {
+  // Slots are never freed, so the probing can stop at the first unused one.
+  for (int i = 0; i < num_slots_; ++i) {
+    ReporterSlot *slot = &slots_[(start + i) % num_slots_];
+    if (!slot->used) {
+      return nullptr;
+    }
+    if (slot->error == error) {
+      return slot;
+    }
+  }
+  return nullptr;
+}
+
+ReporterSlot *ErrorReporterCore::Claim(int start, int64_t now) {
+  ReporterSlot *victim = &slots_[start];
+  for (int i = 0; i < num_slots_; ++i) {
+    ReporterSlot *slot = &slots_[(start + i) % num_slots_];
+    if (!slot->used) {
+      return slot;
+    }
+    if (slot->reported_micros < victim->reported_micros) {
+      victim = slot;
+    }
+  }
+
+  if (victim->pending > 0) {
+    Emit(victim, now);
+    dropped_ += victim->pending;
+  }
+  return victim;
+}
+
+void ErrorReporterCore::Emit(ReporterSlot *slot, int64_t now) {
+  if (!TakeToken(now)) {
+    return;
+  }
+  ErrorReport report;
+  report.error = slot->error;
+  report.count = slot->pending;
+  slot->pending = 0;
+  slot->reported_micros = now;
+  handler_(report);
+}
+
+bool ErrorReporterCore::TakeToken(int64_t now) {
+  if (tokens_ >= policy_.burst) {
+    refilled_micros_ = now;
+  } else {
+    int64_t added = (now - refilled_micros_) / policy_.token_interval_micros;
+    if (added >= policy_.burst - tokens_) {
+      tokens_ = policy_.burst;
+      refilled_micros_ = now;
+    } else if (added > 0) {
+      tokens_ += static_cast<int>(added);
+      refilled_micros_ += added * policy_.token_interval_micros;
+    }
+  }
+  if (tokens_ == 0) {
+    return false;
+  }
+  --tokens_;
+  return true;
+}
+
+} // namespace internal
+} // namespace error
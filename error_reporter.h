@@ -0,0 +1,220 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reports errors with duplicates suppressed and the output rate limited.
+#ifndef ARDUINO_ERROR_ERROR_REPORTER_H
+#define ARDUINO_ERROR_ERROR_REPORTER_H
+
+#include <stdint.h>
+
+#ifdef NATIVE_BUILD
+
+#include <mutex>
+
+#include "clock.h"
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Clock.h>
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+
+// The default number of distinct errors an ErrorReporter tracks.
+const int kDefaultReporterSlots = 8;
+
+// A record emitted by an ErrorReporter.
+struct ErrorReport {
+  // The reported error.
+  Error error;
+
+  // The number of occurrences of the error the record stands for. This is 1
+  // when an error is first seen and the number of suppressed duplicates in the
+  // periodic summaries.
+  uint32_t count;
+};
+
+// Receives the records emitted by an ErrorReporter, e.g. to print them into
+// the serial port or a log. Must not call back into the reporter.
+typedef void (*ErrorReportHandler)(const ErrorReport &report);
+
+// Determines how often an ErrorReporter emits records.
+struct ErrorReporterPolicy {
+  // Creates a policy with the default values.
+  ErrorReporterPolicy();
+
+  // Duplicates of an error are summarized into one record at most once per
+  // this interval. Defaults to 1 second.
+  int64_t summary_interval_micros;
+
+  // The maximum number of records emitted in a burst. Defaults to 10.
+  int burst;
+
+  // A new record can be emitted every this many microseconds once the burst
+  // is used up. Defaults to 100 milliseconds.
+  int64_t token_interval_micros;
+};
+
+namespace internal {
+
+// Tracks the occurrences of one distinct error.
+struct ReporterSlot {
+  Error error;
+  bool used;
+  // The occurrences that weren't reported yet.
+  uint32_t pending;
+  // When the error was last reported.
+  int64_t reported_micros;
+};
+
+// The implementation shared by all BasicErrorReporter sizes.
+class ErrorReporterCore {
+public:
+  ErrorReporterCore(const ErrorReporterPolicy &policy,
+                    ErrorReportHandler handler, Clock *clock,
+                    ReporterSlot *slots, int num_slots);
+
+  void Report(const Error &error);
+  void Poll();
+  uint32_t Dropped() const;
+
+private:
+  // Not copyable.
+  ErrorReporterCore(const ErrorReporterCore &);
+  ErrorReporterCore &operator=(const ErrorReporterCore &);
+
+  // Returns the slot that tracks the error or nullptr if there is none.
+  ReporterSlot *Find(const Error &error, int start);
+
+  // Returns an unused slot, or evicts the least recently reported error.
+  ReporterSlot *Claim(int start, int64_t now);
+
+  // Emits the pending occurrences of the slot if a token is available.
+  void Emit(ReporterSlot *slot, int64_t now);
+
+  // Takes a token from the bucket, returns false if it's empty.
+  bool TakeToken(int64_t now);
+
+  const ErrorReporterPolicy policy_;
+  const ErrorReportHandler handler_;
+  Clock *const clock_;
+  ReporterSlot *const slots_;
+  const int num_slots_;
+  int tokens_;
+  int64_t refilled_micros_;
+  uint32_t dropped_;
+#ifdef NATIVE_BUILD
+  mutable ::std::mutex mutex_;
+#endif // NATIVE_BUILD
+};
+
+} // namespace internal
+
+// Reports errors without flooding the output when the same error occurs over
+// and over, e.g. when a failed sensor is polled in a tight loop.
+//
+// The first occurrence of an error is emitted immediately. Duplicates are
+// counted and emitted as a single summary record at most once per
+// summary_interval_micros. Errors are identified by all their fields and
+// tracked in a table of N slots. When the table is full, the least recently
+// reported error is evicted and its pending occurrences emitted.
+//
+// On top of that, the total number of emitted records is limited by a token
+// bucket. Occurrences that can't be emitted stay pending and are included in
+// a later summary. Only occurrences pending in an evicted slot while the
+// bucket is empty are lost, they are counted by Dropped().
+//
+// The reporter never allocates, the table is part of the object. In native
+// builds all methods are thread-safe. On the Arduino platform the reporter
+// must not be used from interrupt handlers, see IsrErrorQueue.
+//
+// Example use:
+//   void PrintReport(const ErrorReport &report) {
+//     Serial.print(report.error.LibraryNumber());
+//     Serial.print(" x");
+//     Serial.println(report.count);
+//   }
+//
+//   ErrorReporter reporter(ErrorReporterPolicy(), PrintReport);
+//
+//   void loop() {
+//     reporter.Report(sensor.Read());
+//     reporter.Poll();
+//   }
+template <int N> class BasicErrorReporter {
+public:
+  // Creates a reporter that passes the emitted records to the handler.
+  BasicErrorReporter(const ErrorReporterPolicy &policy,
+                     ErrorReportHandler handler);
+
+  // Same as above, but reads the time from the provided clock.
+  BasicErrorReporter(const ErrorReporterPolicy &policy,
+                     ErrorReportHandler handler, Clock *clock);
+
+  // Reports an occurrence of the error. Errors with the code Error::OK are
+  // ignored.
+  void Report(const Error &error);
+
+  // Emits the summaries that are due. Should be called periodically, so the
+  // duplicates of an error that stopped occurring are reported as well.
+  void Poll();
+
+  // Returns the number of occurrences lost because their slot was evicted
+  // while the rate limit didn't allow emitting them.
+  uint32_t Dropped() const;
+
+private:
+  static_assert(N > 0, "the reporter needs at least one slot");
+
+  internal::ReporterSlot slots_[N];
+  internal::ErrorReporterCore core_;
+};
+
+// A reporter with the default number of slots.
+typedef BasicErrorReporter<kDefaultReporterSlots> ErrorReporter;
+
+//
+// Implementation details of the BasicErrorReporter class.
+//
+
+template <int N>
+inline BasicErrorReporter<N>::BasicErrorReporter(
+    const ErrorReporterPolicy &policy, ErrorReportHandler handler)
+    : BasicErrorReporter(policy, handler, SystemClock()) {}
+
+template <int N>
+inline BasicErrorReporter<N>::BasicErrorReporter(
+    const ErrorReporterPolicy &policy, ErrorReportHandler handler,
+    Clock *clock)
+    : slots_(), core_(policy, handler, clock, slots_, N) {}
+
+template <int N>
+inline void BasicErrorReporter<N>::Report(const Error &error) {
+  core_.Report(error);
+}
+
+template <int N> inline void BasicErrorReporter<N>::Poll() { core_.Poll(); }
+
+template <int N> inline uint32_t BasicErrorReporter<N>::Dropped() const {
+  return core_.Dropped();
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_ERROR_REPORTER_H
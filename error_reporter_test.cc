@@ -0,0 +1,205 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_reporter.h"
+
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "testing/fake_clock.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::FakeClock;
+
+const int kLibraryNumber = 51;
+const int64_t kSecond = 1000000;
+
+// The records emitted by the reporters under test.
+std::vector<ErrorReport> reports;
+
+void RecordReport(const ErrorReport &report) { reports.push_back(report); }
+
+Error SensorError(int error_number) {
+  return Error(Error::INTERNAL_ERROR, kLibraryNumber, error_number);
+}
+
+ErrorReporterPolicy TestPolicy() {
+  ErrorReporterPolicy policy;
+  policy.summary_interval_micros = kSecond;
+  policy.burst = 100;
+  policy.token_interval_micros = 1;
+  return policy;
+}
+
+class ErrorReporterTest : public ::testing::Test {
+protected:
+  void SetUp() override { reports.clear(); }
+};
+
+TEST_F(ErrorReporterTest, EmitsFirstOccurrence) {
+  FakeClock clock;
+  ErrorReporter reporter(TestPolicy(), RecordReport, &clock);
+  reporter.Report(SensorError(1));
+
+  ASSERT_EQ(1u, reports.size());
+  EXPECT_THAT(reports[0].error,
+              ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 1));
+  EXPECT_EQ(1u, reports[0].count);
+}
+
+TEST_F(ErrorReporterTest, IgnoresOk) {
+  FakeClock clock;
+  ErrorReporter reporter(TestPolicy(), RecordReport, &clock);
+  reporter.Report(Error::OK);
+  EXPECT_TRUE(reports.empty());
+}
+
+TEST_F(ErrorReporterTest, SummarizesDuplicates) {
+  FakeClock clock;
+  ErrorReporter reporter(TestPolicy(), RecordReport, &clock);
+  for (int i = 0; i < 1000; ++i) {
+    reporter.Report(SensorError(1));
+  }
+  ASSERT_EQ(1u, reports.size());
+
+  clock.AdvanceMicros(kSecond);
+  reporter.Report(SensorError(1));
+  ASSERT_EQ(2u, reports.size());
+  EXPECT_THAT(reports[1].error,
+              ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 1));
+  EXPECT_EQ(1000u, reports[1].count);
+}
+
+TEST_F(ErrorReporterTest, PollEmitsDueSummaries) {
+  FakeClock clock;
+  ErrorReporter reporter(TestPolicy(), RecordReport, &clock);
+  for (int i = 0; i < 5; ++i) {
+    reporter.Report(SensorError(1));
+  }
+  reporter.Poll();
+  ASSERT_EQ(1u, reports.size());
+
+  clock.AdvanceMicros(kSecond);
+  reporter.Poll();
+  ASSERT_EQ(2u, reports.size());
+  EXPECT_EQ(4u, reports[1].count);
+
+  // Nothing is pending anymore.
+  clock.AdvanceMicros(kSecond);
+  reporter.Poll();
+  EXPECT_EQ(2u, reports.size());
+}
+
+TEST_F(ErrorReporterTest, DistinguishesAllFields) {
+  FakeClock clock;
+  ErrorReporter reporter(TestPolicy(), RecordReport, &clock);
+  reporter.Report(Error(Error::INTERNAL_ERROR, kLibraryNumber, 1, 1));
+  reporter.Report(Error(Error::INTERNAL_ERROR, kLibraryNumber, 1, 2));
+  reporter.Report(Error(Error::UNKNOWN, kLibraryNumber, 1, 1));
+  EXPECT_EQ(3u, reports.size());
+}
+
+TEST_F(ErrorReporterTest, LimitsTheRate) {
+  FakeClock clock;
+  ErrorReporterPolicy policy = TestPolicy();
+  policy.burst = 2;
+  policy.token_interval_micros = kSecond;
+  BasicErrorReporter<4> reporter(policy, RecordReport, &clock);
+  reporter.Report(SensorError(1));
+  reporter.Report(SensorError(2));
+  reporter.Report(SensorError(3));
+  ASSERT_EQ(2u, reports.size());
+
+  // The suppressed first occurrence is emitted once a token is available.
+  clock.AdvanceMicros(kSecond);
+  reporter.Poll();
+  ASSERT_EQ(3u, reports.size());
+  EXPECT_THAT(reports[2].error,
+              ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 3));
+  EXPECT_EQ(1u, reports[2].count);
+  EXPECT_EQ(0u, reporter.Dropped());
+}
+
+TEST_F(ErrorReporterTest, EvictsLeastRecentlyReportedError) {
+  FakeClock clock;
+  BasicErrorReporter<2> reporter(TestPolicy(), RecordReport, &clock);
+  reporter.Report(SensorError(1));
+  clock.AdvanceMicros(1);
+  reporter.Report(SensorError(2));
+  reporter.Report(SensorError(1));
+  reporter.Report(SensorError(1));
+  ASSERT_EQ(2u, reports.size());
+
+  // Evicts the first error, its pending occurrences are emitted.
+  reporter.Report(SensorError(3));
+  ASSERT_EQ(4u, reports.size());
+  EXPECT_THAT(reports[2].error,
+              ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 1));
+  EXPECT_EQ(2u, reports[2].count);
+  EXPECT_THAT(reports[3].error,
+              ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 3));
+
+  // The evicted error is reported as a new one.
+  reporter.Report(SensorError(1));
+  ASSERT_EQ(5u, reports.size());
+  EXPECT_EQ(1u, reports[4].count);
+}
+
+TEST_F(ErrorReporterTest, CountsOccurrencesLostOnEviction) {
+  FakeClock clock;
+  ErrorReporterPolicy policy = TestPolicy();
+  policy.burst = 1;
+  policy.token_interval_micros = kSecond;
+  BasicErrorReporter<1> reporter(policy, RecordReport, &clock);
+  reporter.Report(SensorError(1));
+  reporter.Report(SensorError(1));
+  reporter.Report(SensorError(1));
+  reporter.Report(SensorError(2));
+  EXPECT_EQ(1u, reports.size());
+  EXPECT_EQ(2u, reporter.Dropped());
+}
+
+TEST_F(ErrorReporterTest, ThreadSafe) {
+  ErrorReporter reporter(TestPolicy(), RecordReport);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&reporter] {
+      for (int i = 0; i < 10000; ++i) {
+        reporter.Report(SensorError(i % 4));
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  // Every error was seen and no occurrence was reported twice.
+  ASSERT_GE(reports.size(), 4u);
+  uint32_t total = 0;
+  for (const ErrorReport &report : reports) {
+    total += report.count;
+  }
+  EXPECT_LE(total, 40000u);
+  EXPECT_EQ(0u, reporter.Dropped());
+}
+
+} // namespace
+} // namespace error
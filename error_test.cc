@@ -13,6 +13,14 @@
 // limitations under the License.
 
 #include "error.h"
+
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "testing/allocation_tracker.h"
 #include "gtest/gtest.h"
 
 namespace error {
@@ -88,10 +96,100 @@ TEST(ErrorTest, ComparisonOperatorsWork) {
   EXPECT_TRUE(error != different_subcode);
 }
 
+TEST(ErrorTest, OrdersLexicographically) {
+  std::vector<Error> errors = {
+      Error(Error::UNKNOWN),
+      Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber, kSubcode + 1),
+      Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber + 1),
+      Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber, kSubcode),
+      Error(Error::INTERNAL_ERROR, kLibraryNumber + 1),
+      Error(Error::OK),
+  };
+  std::sort(errors.begin(), errors.end());
+
+  EXPECT_EQ(Error(Error::OK), errors[0]);
+  EXPECT_EQ(
+      Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber, kSubcode),
+      errors[1]);
+  EXPECT_EQ(
+      Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber, kSubcode + 1),
+      errors[2]);
+  EXPECT_EQ(Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber + 1),
+            errors[3]);
+  EXPECT_EQ(Error(Error::INTERNAL_ERROR, kLibraryNumber + 1), errors[4]);
+  EXPECT_EQ(Error(Error::UNKNOWN), errors[5]);
+
+  Error error(Error::OK, kLibraryNumber, kErrorNumber, kSubcode);
+  EXPECT_FALSE(error < error);
+}
+
+TEST(ErrorTest, UsableAsKeyOfUnorderedMap) {
+  std::unordered_map<Error, int> counts;
+  ++counts[Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber)];
+  ++counts[Error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber)];
+  ++counts[Error(Error::INTERNAL_ERROR, kLibraryNumber)];
+  EXPECT_EQ(2u, counts.size());
+  EXPECT_EQ(2, counts[Error(Error::INTERNAL_ERROR, kLibraryNumber,
+                            kErrorNumber)]);
+}
+
+TEST(ErrorTest, HashesAllFields) {
+  std::hash<Error> hash;
+  std::set<size_t> hashes;
+  for (int i = 0; i < 100; ++i) {
+    hashes.insert(hash(Error(static_cast<Error::Code>(i))));
+    hashes.insert(hash(Error(Error::INTERNAL_ERROR, i)));
+    hashes.insert(hash(Error(Error::INTERNAL_ERROR, kUnspecified, i)));
+    hashes.insert(
+        hash(Error(Error::INTERNAL_ERROR, kUnspecified, kUnspecified, i)));
+  }
+  // Errors that are equal except for one field don't collide.
+  EXPECT_EQ(400u, hashes.size());
+  EXPECT_EQ(hash(Error(Error::INTERNAL_ERROR, kLibraryNumber)),
+            hash(Error(Error::INTERNAL_ERROR, kLibraryNumber)));
+}
+
 TEST(ErrorTest, ReturnsItself) {
   Error error(Error::OK, kLibraryNumber, kErrorNumber, kSubcode);
   EXPECT_TRUE(error == error.GetError());
 }
 
+TEST(ErrorTest, DoesNotAllocate) {
+  EXPECT_NO_ALLOCATIONS({
+    Error error(Error::INTERNAL_ERROR, kLibraryNumber, kErrorNumber, kSubcode);
+    Error copy = error;
+    EXPECT_TRUE(copy == error);
+    EXPECT_FALSE(copy < error);
+    EXPECT_EQ(std::hash<Error>()(error), std::hash<Error>()(copy));
+  });
+}
+
+// Errors other than Error::OK read the clock when they are traced, so they
+// can't be created in constant expressions.
+#ifndef ERROR_TRACING
+
+constexpr Error kConstantError(Error::INTERNAL_ERROR, kLibraryNumber,
+                               kErrorNumber, kSubcode);
+
+TEST(ErrorTest, UsableInConstantExpressions) {
+  static_assert(Error().Ok(), "default error must be OK");
+  static_assert(!kConstantError.Ok(), "error must not be OK");
+  static_assert(kConstantError.CanonicalCode() == Error::INTERNAL_ERROR,
+                "unexpected canonical code");
+  static_assert(kConstantError.LibraryNumber() == kLibraryNumber,
+                "unexpected library number");
+  static_assert(kConstantError.ErrorNumber() == kErrorNumber,
+                "unexpected error number");
+  static_assert(kConstantError.Subcode() == kSubcode, "unexpected subcode");
+  static_assert(kConstantError == kConstantError.GetError(),
+                "error must equal itself");
+  static_assert(kConstantError != Error(Error::INTERNAL_ERROR),
+                "errors must differ");
+  static_assert(Error(Error::INTERNAL_ERROR) < kConstantError,
+                "errors must be ordered");
+}
+
+#endif // ERROR_TRACING
+
 } // namespace
 } // namespace error
@@ -0,0 +1,170 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_tracing.h"
+
+#include <math.h>
+
+#include <ostream>
+
+namespace error {
+namespace {
+
+// Returns the index of the bucket holding the value. Values below
+// 2 * kSubBuckets have a bucket each, larger values share a bucket with the
+// values that have the same kSubBucketBits + 1 most significant bits.
+int BucketIndex(uint64_t value, int sub_bucket_bits) {
+  int most_significant_bit = value == 0 ? 0 : 63 - __builtin_clzll(value);
+  int shift = most_significant_bit > sub_bucket_bits
+                  ? most_significant_bit - sub_bucket_bits
+                  : 0;
+  return (shift << sub_bucket_bits) + static_cast<int>(value >> shift);
+}
+
+// Returns the largest value of the bucket, the inverse of BucketIndex().
+uint64_t BucketMax(int index, int sub_bucket_bits) {
+  int sub_buckets = 1 << sub_bucket_bits;
+  if (index < 2 * sub_buckets) {
+    return static_cast<uint64_t>(index);
+  }
+  int shift = (index >> sub_bucket_bits) - 1;
+  uint64_t top = static_cast<uint64_t>(sub_buckets + index % sub_buckets);
+  return ((top + 1) << shift) - 1;
+}
+
+LatencyHistogram &ErrorLatencies() {
+  static LatencyHistogram histogram;
+  return histogram;
+}
+
+// The hop counts, the buckets of small values are exact.
+LatencyHistogram &ErrorHops() {
+  static LatencyHistogram histogram;
+  return histogram;
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() { Reset(); }
+
+void LatencyHistogram::Record(int64_t nanos) {
+  if (nanos < 0) {
+    nanos = 0;
+  }
+  int index = BucketIndex(static_cast<uint64_t>(nanos), kSubBucketBits);
+  counts_[index].fetch_add(1, ::std::memory_order_relaxed);
+  count_.fetch_add(1, ::std::memory_order_relaxed);
+  int64_t max = max_.load(::std::memory_order_relaxed);
+  while (nanos > max && !max_.compare_exchange_weak(
+                            max, nanos, ::std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t LatencyHistogram::Count() const {
+  return count_.load(::std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::Max() const {
+  return max_.load(::std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::Percentile(double percentage) const {
+  uint64_t count = Count();
+  if (count == 0) {
+    return 0;
+  }
+  // The rank of the latency at the percentile, counted from one.
+  uint64_t rank = static_cast<uint64_t>(ceil(percentage / 100.0 * count));
+  if (rank < 1) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  int64_t max = Max();
+  for (int i = 0; i < kBuckets; ++i) {
+    seen += counts_[i].load(::std::memory_order_relaxed);
+    if (seen >= rank) {
+      uint64_t bucket_max = BucketMax(i, kSubBucketBits);
+      return bucket_max < static_cast<uint64_t>(max)
+                 ? static_cast<int64_t>(bucket_max)
+                 : max;
+    }
+  }
+  return max;
+}
+
+void LatencyHistogram::Reset() {
+  for (int i = 0; i < kBuckets; ++i) {
+    counts_[i].store(0, ::std::memory_order_relaxed);
+  }
+  count_.store(0, ::std::memory_order_relaxed);
+  max_.store(0, ::std::memory_order_relaxed);
+}
+
+#if defined(ERROR_TRACING) || defined(ERROR_HOP_COUNTING)
+
+void TraceErrorHandled(const Error &error) {
+  if (error.Ok()) {
+    return;
+  }
+#ifdef ERROR_TRACING
+  ErrorLatencies().Record(internal::TraceNow() - error.TraceNanos());
+#endif // ERROR_TRACING
+#ifdef ERROR_HOP_COUNTING
+  ErrorHops().Record(error.Hops());
+#endif // ERROR_HOP_COUNTING
+}
+
+#endif // defined(ERROR_TRACING) || defined(ERROR_HOP_COUNTING)
+
+ErrorLatencyReport GetErrorLatencyReport() {
+  const LatencyHistogram &latencies = ErrorLatencies();
+  ErrorLatencyReport report;
+  report.count = latencies.Count();
+  report.p50_nanos = latencies.Percentile(50.0);
+  report.p90_nanos = latencies.Percentile(90.0);
+  report.p99_nanos = latencies.Percentile(99.0);
+  report.p999_nanos = latencies.Percentile(99.9);
+  report.max_nanos = latencies.Max();
+  return report;
+}
+
+void ResetErrorLatencies() { ErrorLatencies().Reset(); }
+
+ErrorHopReport GetErrorHopReport() {
+  const LatencyHistogram &hops = ErrorHops();
+  ErrorHopReport report;
+  report.count = hops.Count();
+  report.p50_hops = hops.Percentile(50.0);
+  report.p90_hops = hops.Percentile(90.0);
+  report.p99_hops = hops.Percentile(99.0);
+  report.max_hops = hops.Max();
+  return report;
+}
+
+void ResetErrorHops() { ErrorHops().Reset(); }
+
+void PrintTo(const ErrorLatencyReport &report, ::std::ostream *os) {
+  *os << "ErrorLatencyReport(count:" << report.count
+      << " p50:" << report.p50_nanos << "ns p90:" << report.p90_nanos
+      << "ns p99:" << report.p99_nanos << "ns p99.9:" << report.p999_nanos
+      << "ns max:" << report.max_nanos << "ns)";
+}
+
+void PrintTo(const ErrorHopReport &report, ::std::ostream *os) {
+  *os << "ErrorHopReport(count:" << report.count << " p50:" << report.p50_hops
+      << " p90:" << report.p90_hops << " p99:" << report.p99_hops
+      << " max:" << report.max_hops << ")";
+}
+
+} // namespace error
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how long errors take from their creation to being handled, and
+// how many callers they were propagated through.
+// Only available in native builds (-DNATIVE_BUILD).
+#ifndef ARDUINO_ERROR_ERROR_TRACING_H
+#define ARDUINO_ERROR_ERROR_TRACING_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <ostream>
+
+#include "error.h"
+
+namespace error {
+
+// A histogram of latencies in nanoseconds. Like in HdrHistogram, the buckets
+// cover each power of two with kSubBuckets linear sub-buckets, so a recorded
+// latency is known within 1/kSubBuckets of its value while the histogram
+// covers all int64_t values in a few kilobytes.
+//
+// Record() is lock-free and can be called from any thread. The other methods
+// can run concurrently with Record(), but then they might miss the latencies
+// that are being recorded.
+class LatencyHistogram {
+public:
+  // Creates an empty histogram.
+  LatencyHistogram();
+
+  // Counts the latency. Negative latencies are counted as zero.
+  void Record(int64_t nanos);
+
+  // Returns the number of recorded latencies.
+  uint64_t Count() const;
+
+  // Returns the largest recorded latency, or zero if none was recorded.
+  int64_t Max() const;
+
+  // Returns the latency that the provided percentage of the recorded latencies
+  // doesn't exceed, for example 99.0 for the 99th percentile. Returns the
+  // largest value of the bucket holding the percentile, but never more than
+  // Max(). Returns zero if no latency was recorded.
+  int64_t Percentile(double percentage) const;
+
+  // Removes all recorded latencies.
+  void Reset();
+
+private:
+  static const int kSubBucketBits = 3;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  // Enough buckets for the largest int64_t value.
+  static const int kBuckets = (63 - kSubBucketBits + 1) * kSubBuckets;
+
+  // Not copyable.
+  LatencyHistogram(const LatencyHistogram &);
+  LatencyHistogram &operator=(const LatencyHistogram &);
+
+  ::std::atomic<uint64_t> counts_[kBuckets];
+  ::std::atomic<uint64_t> count_;
+  ::std::atomic<int64_t> max_;
+};
+
+// A summary of the latencies recorded by TraceErrorHandled(), in nanoseconds.
+struct ErrorLatencyReport {
+  uint64_t count;
+  int64_t p50_nanos;
+  int64_t p90_nanos;
+  int64_t p99_nanos;
+  int64_t p999_nanos;
+  int64_t max_nanos;
+};
+
+// A summary of the hop counts recorded by TraceErrorHandled(), see
+// Error::Hops().
+struct ErrorHopReport {
+  uint64_t count;
+  int64_t p50_hops;
+  int64_t p90_hops;
+  int64_t p99_hops;
+  int64_t max_hops;
+};
+
+// Records the time since the error was created and the number of hops it
+// took. Should be called where the error is finally handled, after it was
+// propagated through the callers, retried and so on. Does nothing for
+// Error::OK.
+//
+// Errors only carry their creation time when the whole program is compiled
+// with -DERROR_TRACING, and their hop count with -DERROR_HOP_COUNTING. Without
+// either flag this function compiles to nothing. All code linked into the
+// program must agree on the flags, because they change the layout of Error.
+//
+// Example use:
+//   Error error = ReadSensor();
+//   if (!error.Ok()) {
+//     TraceErrorHandled(error);
+//     ...
+//   }
+#if defined(ERROR_TRACING) || defined(ERROR_HOP_COUNTING)
+void TraceErrorHandled(const Error &error);
+#else  // defined(ERROR_TRACING) || defined(ERROR_HOP_COUNTING)
+inline void TraceErrorHandled(const Error &) {}
+#endif // defined(ERROR_TRACING) || defined(ERROR_HOP_COUNTING)
+
+// Returns a summary of the latencies recorded by TraceErrorHandled() since the
+// start of the program or the last reset.
+ErrorLatencyReport GetErrorLatencyReport();
+
+// Removes the latencies recorded by TraceErrorHandled().
+void ResetErrorLatencies();
+
+// Returns a summary of the hop counts recorded by TraceErrorHandled() since
+// the start of the program or the last reset. Hop counts up to 15 are exact,
+// larger ones are rounded up by less than an eighth.
+ErrorHopReport GetErrorHopReport();
+
+// Removes the hop counts recorded by TraceErrorHandled().
+void ResetErrorHops();
+
+// Prints human readable representation of the reports.
+void PrintTo(const ErrorLatencyReport &report, ::std::ostream *os);
+void PrintTo(const ErrorHopReport &report, ::std::ostream *os);
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_ERROR_TRACING_H
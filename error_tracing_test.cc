@@ -0,0 +1,177 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_tracing.h"
+
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+const int64_t kMillisecond = 1000000;
+
+TEST(LatencyHistogramTest, EmptyHistogram) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.Count());
+  EXPECT_EQ(0, histogram.Max());
+  EXPECT_EQ(0, histogram.Percentile(50.0));
+}
+
+TEST(LatencyHistogramTest, SmallLatenciesAreExact) {
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 10; ++i) {
+    histogram.Record(i);
+  }
+  EXPECT_EQ(10u, histogram.Count());
+  EXPECT_EQ(1, histogram.Percentile(0.0));
+  EXPECT_EQ(5, histogram.Percentile(50.0));
+  EXPECT_EQ(9, histogram.Percentile(90.0));
+  EXPECT_EQ(10, histogram.Percentile(100.0));
+  EXPECT_EQ(10, histogram.Max());
+}
+
+TEST(LatencyHistogramTest, LargeLatenciesArePreciseToOneEighth) {
+  LatencyHistogram histogram;
+  for (int64_t i = 1; i <= 1000; ++i) {
+    histogram.Record(i * kMillisecond);
+  }
+  const int64_t p50 = histogram.Percentile(50.0);
+  EXPECT_GE(p50, 500 * kMillisecond);
+  EXPECT_LE(p50, 500 * kMillisecond + 500 * kMillisecond / 8);
+  const int64_t p99 = histogram.Percentile(99.0);
+  EXPECT_GE(p99, 990 * kMillisecond);
+  EXPECT_LE(p99, 1000 * kMillisecond);
+  EXPECT_EQ(1000 * kMillisecond, histogram.Percentile(100.0));
+}
+
+TEST(LatencyHistogramTest, CoversAllValues) {
+  LatencyHistogram histogram;
+  histogram.Record(INT64_MAX);
+  EXPECT_EQ(INT64_MAX, histogram.Percentile(50.0));
+}
+
+TEST(LatencyHistogramTest, CountsNegativeLatenciesAsZero) {
+  LatencyHistogram histogram;
+  histogram.Record(-5);
+  EXPECT_EQ(1u, histogram.Count());
+  EXPECT_EQ(0, histogram.Percentile(100.0));
+}
+
+TEST(LatencyHistogramTest, Resets) {
+  LatencyHistogram histogram;
+  histogram.Record(kMillisecond);
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.Count());
+  EXPECT_EQ(0, histogram.Max());
+}
+
+TEST(LatencyHistogramTest, RecordsFromMultipleThreads) {
+  const int kThreads = 4;
+  const int kLatenciesPerThread = 10000;
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&histogram, t] {
+      for (int i = 0; i < kLatenciesPerThread; ++i) {
+        histogram.Record(t * kLatenciesPerThread + i);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kThreads * kLatenciesPerThread),
+            histogram.Count());
+  EXPECT_EQ(kThreads * kLatenciesPerThread - 1, histogram.Max());
+}
+
+class TraceErrorHandledTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ResetErrorLatencies();
+    ResetErrorHops();
+  }
+};
+
+#ifdef ERROR_TRACING
+
+TEST_F(TraceErrorHandledTest, RecordsLatencySinceCreation) {
+  Error error(Error::INTERNAL_ERROR);
+  usleep(2000);
+  TraceErrorHandled(error);
+
+  ErrorLatencyReport report = GetErrorLatencyReport();
+  EXPECT_EQ(1u, report.count);
+  EXPECT_GE(report.p50_nanos, 2 * kMillisecond);
+  EXPECT_EQ(report.max_nanos, report.p999_nanos);
+}
+
+TEST_F(TraceErrorHandledTest, CopiesKeepCreationTime) {
+  Error error(Error::INTERNAL_ERROR);
+  Error copy = error;
+  EXPECT_EQ(error.TraceNanos(), copy.TraceNanos());
+  EXPECT_NE(0, error.TraceNanos());
+  EXPECT_EQ(Error(Error::INTERNAL_ERROR), error);
+}
+
+TEST_F(TraceErrorHandledTest, IgnoresOk) {
+  EXPECT_EQ(0, Error().TraceNanos());
+  TraceErrorHandled(Error::OK);
+  EXPECT_EQ(0u, GetErrorLatencyReport().count);
+}
+
+#else // ERROR_TRACING
+
+TEST_F(TraceErrorHandledTest, DoesNothingWithoutTracing) {
+  TraceErrorHandled(Error::INTERNAL_ERROR);
+  EXPECT_EQ(0u, GetErrorLatencyReport().count);
+}
+
+#endif // ERROR_TRACING
+
+#ifdef ERROR_HOP_COUNTING
+
+TEST_F(TraceErrorHandledTest, RecordsHops) {
+  Error error(Error::INTERNAL_ERROR);
+  TraceErrorHandled(error);
+  for (int i = 0; i < 3; ++i) {
+    internal::AddHop(&error);
+  }
+  TraceErrorHandled(error);
+  TraceErrorHandled(Error::OK);
+
+  ErrorHopReport report = GetErrorHopReport();
+  EXPECT_EQ(2u, report.count);
+  EXPECT_EQ(0, report.p50_hops);
+  EXPECT_EQ(3, report.p90_hops);
+  EXPECT_EQ(3, report.max_hops);
+}
+
+#else // ERROR_HOP_COUNTING
+
+TEST_F(TraceErrorHandledTest, RecordsNoHopsWithoutHopCounting) {
+  TraceErrorHandled(Error::INTERNAL_ERROR);
+  EXPECT_EQ(0u, GetErrorHopReport().count);
+}
+
+#endif // ERROR_HOP_COUNTING
+
+} // namespace
+} // namespace error
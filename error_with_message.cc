@@ -0,0 +1,43 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_with_message.h"
+
+namespace error {
+
+MessageArena::MessageArena(size_t capacity)
+    : buffer_(new char[capacity]), capacity_(capacity), used_(0) {}
+
+MessageArena::~MessageArena() { delete[] buffer_; }
+
+char *MessageArena::Allocate(size_t size) {
+  size_t used = used_.load(std::memory_order_relaxed);
+  do {
+    if (size > capacity_ - used) {
+      return nullptr;
+    }
+  } while (!used_.compare_exchange_weak(used, used + size,
+                                        std::memory_order_relaxed));
+  return buffer_ + used;
+}
+
+size_t MessageArena::Used() const {
+  return used_.load(std::memory_order_relaxed);
+}
+
+size_t MessageArena::Capacity() const { return capacity_; }
+
+void MessageArena::Reset() { used_.store(0, std::memory_order_relaxed); }
+
+} // namespace error
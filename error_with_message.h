@@ -0,0 +1,258 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// An error with a human readable message stored without heap allocations.
+#ifndef ARDUINO_ERROR_ERROR_WITH_MESSAGE_H
+#define ARDUINO_ERROR_ERROR_WITH_MESSAGE_H
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef NATIVE_BUILD
+
+#include <atomic>
+#include <ostream>
+
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+
+// The default size of the message buffer, including the terminating null
+// character.
+const size_t kDefaultMessageSize = 32;
+
+#ifdef NATIVE_BUILD
+
+// A bounded memory pool for messages that don't fit into the buffer of an
+// ErrorWithMessage. The memory is allocated once when the arena is created
+// and handed out until it is exhausted. Thread-safe.
+//
+// Messages stored in the arena are referenced by the errors, so the arena must
+// outlive all errors that use it. Only available in native builds.
+class MessageArena {
+public:
+  explicit MessageArena(size_t capacity);
+  ~MessageArena();
+
+  // Returns a block of the requested size or nullptr if the arena doesn't have
+  // enough free space.
+  char *Allocate(size_t size);
+
+  // Returns the number of allocated bytes.
+  size_t Used() const;
+
+  // Returns the number of bytes the arena can hold.
+  size_t Capacity() const;
+
+  // Makes all the memory available again. Must only be called when no error
+  // references a message stored in the arena.
+  void Reset();
+
+private:
+  // Not copyable.
+  MessageArena(const MessageArena &);
+  MessageArena &operator=(const MessageArena &);
+
+  char *const buffer_;
+  const size_t capacity_;
+  std::atomic<size_t> used_;
+};
+
+#endif // NATIVE_BUILD
+
+// An Error accompanied by a message that describes it.
+//
+// The message is copied into a buffer of N bytes stored inline. Longer
+// messages are truncated, which is reported by Truncated(). In native builds
+// an optional MessageArena can hold the messages that don't fit inline.
+//
+// The plain Error is unaffected, this type should only be used where the
+// message is worth the extra N bytes.
+//
+// Example use:
+//   ErrorWithMessage ReadSensor() {
+//     if (!sensor.Ready()) {
+//       return ErrorWithMessage(Error::INTERNAL_ERROR, "sensor not ready");
+//     }
+//     return Error::OK;
+//   }
+template <size_t N> class BasicErrorWithMessage {
+public:
+  // Creates an error with the code Error::OK and an empty message.
+  BasicErrorWithMessage();
+
+  // Creates an error with an empty message.
+  BasicErrorWithMessage(Error error);
+  BasicErrorWithMessage(Error::Code error_code);
+
+  // Creates an error with the provided message.
+  BasicErrorWithMessage(Error error, const char *message);
+
+#ifdef NATIVE_BUILD
+
+  // Creates an error with the provided message. If the message doesn't fit
+  // into the inline buffer, it is stored in the arena instead. The message is
+  // truncated only if the arena is exhausted or null.
+  BasicErrorWithMessage(Error error, const char *message, MessageArena *arena);
+
+#endif // NATIVE_BUILD
+
+  ~BasicErrorWithMessage();
+
+  // Determines if the operation succeeded.
+  bool Ok() const;
+
+  // Returns the error without the message.
+  const Error &GetError() const;
+
+  // Returns the null terminated message.
+  const char *Message() const;
+
+  // Determines if the message was truncated because it didn't fit.
+  bool Truncated() const;
+
+private:
+  static_assert(N > 0, "the message buffer must fit the null character");
+
+  // Copies as much of the message as fits into the inline buffer.
+  void CopyInline(const char *message, size_t length);
+
+  Error error_;
+  bool truncated_;
+#ifdef NATIVE_BUILD
+  // The message stored in an arena or nullptr if it is stored inline.
+  const char *arena_message_;
+#endif // NATIVE_BUILD
+  char message_[N];
+};
+
+// An error with a message of the default size.
+typedef BasicErrorWithMessage<kDefaultMessageSize> ErrorWithMessage;
+
+//
+// Implementation details of the BasicErrorWithMessage class.
+//
+
+template <size_t N>
+inline BasicErrorWithMessage<N>::BasicErrorWithMessage()
+    : BasicErrorWithMessage(Error(Error::OK)) {}
+
+template <size_t N>
+inline BasicErrorWithMessage<N>::BasicErrorWithMessage(Error error)
+    : error_(error), truncated_(false)
+#ifdef NATIVE_BUILD
+      ,
+      arena_message_(nullptr)
+#endif // NATIVE_BUILD
+{
+  message_[0] = '\0';
+}
+
+template <size_t N>
+inline BasicErrorWithMessage<N>::BasicErrorWithMessage(Error::Code error_code)
+    : BasicErrorWithMessage(Error(error_code)) {}
+
+template <size_t N>
+inline BasicErrorWithMessage<N>::BasicErrorWithMessage(Error error,
+                                                       const char *message)
+    : BasicErrorWithMessage(error) {
+  CopyInline(message, strlen(message));
+}
+
+#ifdef NATIVE_BUILD
+
+template <size_t N>
+inline BasicErrorWithMessage<N>::BasicErrorWithMessage(Error error,
+                                                       const char *message,
+                                                       MessageArena *arena)
+    : BasicErrorWithMessage(error) {
+  size_t length = strlen(message);
+  if (length < N) {
+    CopyInline(message, length);
+    return;
+  }
+
+  char *block = arena != nullptr ? arena->Allocate(length + 1) : nullptr;
+  if (block == nullptr) {
+    CopyInline(message, length);
+    return;
+  }
+  memcpy(block, message, length + 1);
+  arena_message_ = block;
+}
+
+#endif // NATIVE_BUILD
+
+template <size_t N> inline BasicErrorWithMessage<N>::~BasicErrorWithMessage() {}
+
+template <size_t N> inline bool BasicErrorWithMessage<N>::Ok() const {
+  return error_.Ok();
+}
+
+template <size_t N>
+inline const Error &BasicErrorWithMessage<N>::GetError() const {
+  return error_;
+}
+
+template <size_t N>
+inline const char *BasicErrorWithMessage<N>::Message() const {
+#ifdef NATIVE_BUILD
+  if (arena_message_ != nullptr) {
+    return arena_message_;
+  }
+#endif // NATIVE_BUILD
+  return message_;
+}
+
+template <size_t N> inline bool BasicErrorWithMessage<N>::Truncated() const {
+  return truncated_;
+}
+
+template <size_t N>
+inline void BasicErrorWithMessage<N>::CopyInline(const char *message,
+                                                 size_t length) {
+  if (length >= N) {
+    length = N - 1;
+    truncated_ = true;
+  }
+  memcpy(message_, message, length);
+  message_[length] = '\0';
+}
+
+#ifdef NATIVE_BUILD
+
+// Prints a human readable representation of the error and its message for use
+// in tests.
+template <size_t N>
+void PrintTo(const BasicErrorWithMessage<N> &error, ::std::ostream *os) {
+  PrintTo(error.GetError(), os);
+  *os << " with message \"" << error.Message() << "\"";
+  if (error.Truncated()) {
+    *os << " (truncated)";
+  }
+}
+
+#endif // NATIVE_BUILD
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_ERROR_WITH_MESSAGE_H
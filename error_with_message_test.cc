@@ -0,0 +1,143 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "error_with_message.h"
+
+#include <string>
+
+#include "error.h"
+#include "error_macros.h"
+#include "gmock/gmock.h"
+#include "testing/allocation_tracker.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::StrEq;
+using ::testing::error::AllocationTracker;
+using ::testing::error::ErrorIs;
+using ::testing::error::IsOk;
+
+const int kLibraryNumber = 9;
+
+TEST(ErrorWithMessageTest, OkByDefault) {
+  ErrorWithMessage error;
+  EXPECT_THAT(error, IsOk());
+  EXPECT_THAT(error.Message(), StrEq(""));
+  EXPECT_FALSE(error.Truncated());
+}
+
+TEST(ErrorWithMessageTest, HoldsErrorAndMessage) {
+  ErrorWithMessage error(Error(Error::INTERNAL_ERROR, kLibraryNumber),
+                         "sensor not ready");
+  EXPECT_FALSE(error.Ok());
+  EXPECT_THAT(error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber));
+  EXPECT_THAT(error.Message(), StrEq("sensor not ready"));
+  EXPECT_FALSE(error.Truncated());
+}
+
+TEST(ErrorWithMessageTest, FillsBuffer) {
+  BasicErrorWithMessage<4> error(Error::INTERNAL_ERROR, "abc");
+  EXPECT_THAT(error.Message(), StrEq("abc"));
+  EXPECT_FALSE(error.Truncated());
+}
+
+TEST(ErrorWithMessageTest, TruncatesLongMessage) {
+  BasicErrorWithMessage<4> error(Error::INTERNAL_ERROR, "abcdef");
+  EXPECT_THAT(error.Message(), StrEq("abc"));
+  EXPECT_TRUE(error.Truncated());
+}
+
+TEST(ErrorWithMessageTest, CopiesMessage) {
+  ErrorWithMessage copy;
+  {
+    std::string message = "temporary";
+    ErrorWithMessage error(Error::INTERNAL_ERROR, message.c_str());
+    copy = error;
+    message[0] = 'X';
+  }
+  EXPECT_THAT(copy.Message(), StrEq("temporary"));
+}
+
+TEST(ErrorWithMessageTest, StoresLongMessageInArena) {
+  MessageArena arena(64);
+  BasicErrorWithMessage<4> error(Error::INTERNAL_ERROR, "abcdef", &arena);
+  EXPECT_THAT(error.Message(), StrEq("abcdef"));
+  EXPECT_FALSE(error.Truncated());
+  EXPECT_EQ(7u, arena.Used());
+}
+
+TEST(ErrorWithMessageTest, StoresShortMessageInline) {
+  MessageArena arena(64);
+  BasicErrorWithMessage<4> error(Error::INTERNAL_ERROR, "abc", &arena);
+  EXPECT_THAT(error.Message(), StrEq("abc"));
+  EXPECT_EQ(0u, arena.Used());
+}
+
+TEST(ErrorWithMessageTest, TruncatesWhenArenaExhausted) {
+  MessageArena arena(8);
+  BasicErrorWithMessage<4> first(Error::INTERNAL_ERROR, "abcdef", &arena);
+  BasicErrorWithMessage<4> second(Error::INTERNAL_ERROR, "ghijkl", &arena);
+  EXPECT_THAT(first.Message(), StrEq("abcdef"));
+  EXPECT_FALSE(first.Truncated());
+  EXPECT_THAT(second.Message(), StrEq("ghi"));
+  EXPECT_TRUE(second.Truncated());
+
+  arena.Reset();
+  EXPECT_EQ(0u, arena.Used());
+}
+
+TEST(ErrorWithMessageTest, TruncatesWithoutArena) {
+  BasicErrorWithMessage<4> error(Error::INTERNAL_ERROR, "abcdef", nullptr);
+  EXPECT_THAT(error.Message(), StrEq("abc"));
+  EXPECT_TRUE(error.Truncated());
+}
+
+ErrorWithMessage Fail() {
+  return ErrorWithMessage(Error::INVALID_ARGUMENT, "negative sample");
+}
+
+ErrorWithMessage Forward() {
+  RETURN_IF_ERROR(Fail());
+  return Error::OK;
+}
+
+TEST(ErrorWithMessageTest, WorksWithMacros) {
+  ErrorWithMessage error = Forward();
+  EXPECT_THAT(error, ErrorIs(Error::INVALID_ARGUMENT));
+  EXPECT_THAT(error.Message(), StrEq("negative sample"));
+}
+
+TEST(ErrorWithMessageTest, DoesNotAllocate) {
+  MessageArena arena(64);
+  AllocationTracker tracker;
+  ErrorWithMessage inline_message = Forward();
+  BasicErrorWithMessage<4> arena_message(Error::INTERNAL_ERROR, "abcdef",
+                                         &arena);
+  ErrorWithMessage copy = inline_message;
+  EXPECT_EQ(0u, tracker.Allocations());
+  EXPECT_THAT(copy.Message(), StrEq("negative sample"));
+  EXPECT_THAT(arena_message.Message(), StrEq("abcdef"));
+}
+
+TEST(ErrorWithMessageTest, PrintsMessage) {
+  BasicErrorWithMessage<4> error(Error::INTERNAL_ERROR, "abcdef");
+  EXPECT_EQ("Error(Code:INTERNAL_ERROR) with message \"abc\" (truncated)",
+            ::testing::PrintToString(error));
+}
+
+} // namespace
+} // namespace error
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A queue that passes errors detected in interrupt handlers to the main loop.
+#ifndef ARDUINO_ERROR_ISR_ERROR_QUEUE_H
+#define ARDUINO_ERROR_ISR_ERROR_QUEUE_H
+
+#include <stdint.h>
+
+#ifdef NATIVE_BUILD
+
+#include <atomic>
+
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace internal {
+
+#ifdef NATIVE_BUILD
+
+typedef ::std::atomic<uint8_t> IsrIndex;
+typedef ::std::atomic<uint16_t> IsrCounter;
+
+#else // NATIVE_BUILD
+
+// Single byte accesses are atomic on all Arduino boards, so an index can be
+// shared with an interrupt handler without disabling interrupts.
+typedef volatile uint8_t IsrIndex;
+typedef volatile uint16_t IsrCounter;
+
+#endif // NATIVE_BUILD
+
+} // namespace internal
+
+// A wait-free single-producer single-consumer queue of errors.
+//
+// The producer is an interrupt service routine (or a POSIX signal handler in
+// native builds) that detects errors it can't handle on its own. Push() only
+// copies the error and updates one byte, so it is safe to call from an ISR.
+// The consumer is the main loop that calls Pop() or Drain() and handles the
+// errors at its own pace.
+//
+// The queue never allocates, its storage is part of the object. Errors pushed
+// into a full queue are dropped and counted, see Overflows(). The capacity
+// must be a power of two between 1 and 128.
+//
+// Example use:
+//   IsrErrorQueue<8> isr_errors;
+//
+//   void OnTimer() {
+//     if (!sensor.Ready()) {
+//       isr_errors.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber));
+//     }
+//   }
+//
+//   void loop() {
+//     Error error;
+//     while (isr_errors.Pop(&error)) {
+//       Report(error);
+//     }
+//   }
+template <uint8_t Capacity> class IsrErrorQueue {
+public:
+  static_assert(Capacity > 0 && Capacity <= 128 &&
+                    (Capacity & (Capacity - 1)) == 0,
+                "the capacity must be a power of two between 1 and 128");
+
+  // Creates an empty queue.
+  IsrErrorQueue();
+
+  // Queues the error. Returns false and counts the overflow if the queue is
+  // full. Must only be called by the producer.
+  bool Push(const Error &error);
+
+  // Removes the oldest error from the queue and stores it into the provided
+  // pointer. Returns false if the queue is empty. Must only be called by the
+  // consumer.
+  bool Pop(Error *error);
+
+  // Removes the errors queued before the call and calls the handler with each
+  // of them in the order they were pushed. Returns the number of handled
+  // errors. Must only be called by the consumer.
+  template <typename Handler> uint8_t Drain(Handler handler);
+
+  // Determines if the queue is empty.
+  bool Empty() const;
+
+  // Returns the number of errors dropped because the queue was full. Stops
+  // counting at 65535.
+  uint16_t Overflows() const;
+
+private:
+  // Not copyable.
+  IsrErrorQueue(const IsrErrorQueue &);
+  IsrErrorQueue &operator=(const IsrErrorQueue &);
+
+  static const uint8_t kMask = Capacity - 1;
+  static const uint16_t kMaxOverflows = 0xFFFF;
+
+  // Free running positions, they wrap around at 256.
+  internal::IsrIndex head_;
+  internal::IsrIndex tail_;
+  // Only modified by the producer.
+  internal::IsrCounter overflows_;
+  Error errors_[Capacity];
+};
+
+//
+// Implementation details of the IsrErrorQueue class.
+//
+
+namespace internal {
+
+// LoadAcquire() reads an index written by the other side of the queue,
+// accesses of the queued errors can't be moved before it. StoreRelease()
+// publishes an index to the other side, accesses of the queued errors can't be
+// moved after it.
+
+#ifdef NATIVE_BUILD
+
+inline uint8_t LoadAcquire(const IsrIndex &index) {
+  return index.load(::std::memory_order_acquire);
+}
+
+inline void StoreRelease(IsrIndex *index, uint8_t value) {
+  index->store(value, ::std::memory_order_release);
+}
+
+inline uint16_t LoadCounter(const IsrCounter &counter) {
+  return counter.load(::std::memory_order_relaxed);
+}
+
+#else // NATIVE_BUILD
+
+// The boards are single core, preventing the compiler from reordering the
+// memory accesses is enough.
+inline uint8_t LoadAcquire(const IsrIndex &index) {
+  uint8_t value = index;
+  __asm__ __volatile__("" ::: "memory");
+  return value;
+}
+
+inline void StoreRelease(IsrIndex *index, uint8_t value) {
+  __asm__ __volatile__("" ::: "memory");
+  *index = value;
+}
+
+// The counter takes two instructions to read, an interrupt between them could
+// produce a torn value. Reads until two consecutive reads agree.
+inline uint16_t LoadCounter(const IsrCounter &counter) {
+  uint16_t value = counter;
+  uint16_t again = counter;
+  while (value != again) {
+    value = again;
+    again = counter;
+  }
+  return value;
+}
+
+#endif // NATIVE_BUILD
+
+} // namespace internal
+
+template <uint8_t Capacity>
+inline IsrErrorQueue<Capacity>::IsrErrorQueue()
+    : head_(0), tail_(0), overflows_(0) {}
+
+template <uint8_t Capacity>
+inline bool IsrErrorQueue<Capacity>::Push(const Error &error) {
+  uint8_t tail = tail_;
+  if (static_cast<uint8_t>(tail - internal::LoadAcquire(head_)) == Capacity) {
+    uint16_t overflows = overflows_;
+    if (overflows != kMaxOverflows) {
+      overflows_ = overflows + 1;
+    }
+    return false;
+  }
+  errors_[tail & kMask] = error;
+  internal::StoreRelease(&tail_, tail + 1);
+  return true;
+}
+
+template <uint8_t Capacity>
+inline bool IsrErrorQueue<Capacity>::Pop(Error *error) {
+  uint8_t head = head_;
+  if (head == internal::LoadAcquire(tail_)) {
+    return false;
+  }
+  *error = errors_[head & kMask];
+  internal::StoreRelease(&head_, head + 1);
+  return true;
+}
+
+template <uint8_t Capacity>
+template <typename Handler>
+inline uint8_t IsrErrorQueue<Capacity>::Drain(Handler handler) {
+  // Only drains the errors queued before the call, so an interrupt handler
+  // that keeps pushing can't keep the consumer here forever.
+  uint8_t head = head_;
+  const uint8_t tail = internal::LoadAcquire(tail_);
+  const uint8_t handled = tail - head;
+  while (head != tail) {
+    Error error = errors_[head & kMask];
+    internal::StoreRelease(&head_, ++head);
+    handler(error);
+  }
+  return handled;
+}
+
+template <uint8_t Capacity> inline bool IsrErrorQueue<Capacity>::Empty() const {
+  return internal::LoadAcquire(head_) == internal::LoadAcquire(tail_);
+}
+
+template <uint8_t Capacity>
+inline uint16_t IsrErrorQueue<Capacity>::Overflows() const {
+  return internal::LoadCounter(overflows_);
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_ISR_ERROR_QUEUE_H
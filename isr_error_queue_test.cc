@@ -0,0 +1,212 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "isr_error_queue.h"
+
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <vector>
+
+#include "error.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+
+const int kLibraryNumber = 41;
+
+TEST(IsrErrorQueueTest, EmptyByDefault) {
+  IsrErrorQueue<4> queue;
+  EXPECT_TRUE(queue.Empty());
+  EXPECT_EQ(0, queue.Overflows());
+
+  Error error;
+  EXPECT_FALSE(queue.Pop(&error));
+}
+
+TEST(IsrErrorQueueTest, PopsErrorsInOrder) {
+  IsrErrorQueue<4> queue;
+  EXPECT_TRUE(queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, 1)));
+  EXPECT_TRUE(queue.Push(Error(Error::INVALID_ARGUMENT, kLibraryNumber, 2)));
+  EXPECT_FALSE(queue.Empty());
+
+  Error error;
+  ASSERT_TRUE(queue.Pop(&error));
+  EXPECT_THAT(error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 1));
+  ASSERT_TRUE(queue.Pop(&error));
+  EXPECT_THAT(error, ErrorIs(Error::INVALID_ARGUMENT, kLibraryNumber, 2));
+  EXPECT_FALSE(queue.Pop(&error));
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(IsrErrorQueueTest, CountsOverflows) {
+  IsrErrorQueue<2> queue;
+  EXPECT_TRUE(queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, 1)));
+  EXPECT_TRUE(queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, 2)));
+  EXPECT_FALSE(queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, 3)));
+  EXPECT_FALSE(queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, 4)));
+  EXPECT_EQ(2, queue.Overflows());
+
+  // The dropped errors are the newest ones.
+  Error error;
+  ASSERT_TRUE(queue.Pop(&error));
+  EXPECT_THAT(error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 1));
+  EXPECT_TRUE(queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, 5)));
+  ASSERT_TRUE(queue.Pop(&error));
+  EXPECT_THAT(error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 2));
+  ASSERT_TRUE(queue.Pop(&error));
+  EXPECT_THAT(error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, 5));
+}
+
+TEST(IsrErrorQueueTest, WrapsAroundPositions) {
+  IsrErrorQueue<128> queue;
+  Error error;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, i)));
+    ASSERT_TRUE(queue.Pop(&error));
+    ASSERT_THAT(error, ErrorIs(Error::INTERNAL_ERROR, kLibraryNumber, i));
+  }
+  for (int i = 0; i < 128; ++i) {
+    ASSERT_TRUE(queue.Push(Error::INTERNAL_ERROR));
+  }
+  EXPECT_FALSE(queue.Push(Error::INTERNAL_ERROR));
+  EXPECT_EQ(1, queue.Overflows());
+}
+
+TEST(IsrErrorQueueTest, DrainsQueuedErrors) {
+  IsrErrorQueue<8> queue;
+  for (int i = 0; i < 3; ++i) {
+    queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, i));
+  }
+
+  std::vector<int> error_numbers;
+  EXPECT_EQ(3, queue.Drain([&error_numbers](const Error &error) {
+    error_numbers.push_back(error.ErrorNumber());
+  }));
+  EXPECT_THAT(error_numbers, ::testing::ElementsAre(0, 1, 2));
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(IsrErrorQueueTest, StopsCountingOverflows) {
+  IsrErrorQueue<1> queue;
+  queue.Push(Error::INTERNAL_ERROR);
+  for (int i = 0; i < 70000; ++i) {
+    queue.Push(Error::INTERNAL_ERROR);
+  }
+  EXPECT_EQ(65535, queue.Overflows());
+}
+
+// The queue shared with the signal handler of the stress test.
+IsrErrorQueue<16> signal_queue;
+
+// The number of errors the signal handler tried to push.
+std::atomic<int> signal_pushes(0);
+
+void PushFromSignalHandler(int) {
+  int number = signal_pushes.load(std::memory_order_relaxed);
+  signal_queue.Push(Error(Error::INTERNAL_ERROR, kLibraryNumber, number));
+  signal_pushes.store(number + 1, std::memory_order_relaxed);
+}
+
+// Sets an interval timer that raises SIGALRM every interval_micros, zero stops
+// the timer. Returns false if the timer couldn't be set.
+bool SetTimer(int interval_micros) {
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = interval_micros;
+  timer.it_value = timer.it_interval;
+  return setitimer(ITIMER_REAL, &timer, nullptr) == 0;
+}
+
+// Calls the handler on SIGALRM every interval_micros while in scope. Stops the
+// timer and restores the previous handler when destroyed, also when an
+// assertion returns early from the test.
+class ScopedAlarm {
+public:
+  ScopedAlarm(void (*handler)(int), int interval_micros)
+      : handler_installed_(false), timer_set_(false) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    handler_installed_ = sigaction(SIGALRM, &action, &previous_) == 0;
+    if (handler_installed_) {
+      timer_set_ = SetTimer(interval_micros);
+    }
+  }
+
+  ~ScopedAlarm() {
+    if (timer_set_) {
+      SetTimer(0);
+    }
+    if (handler_installed_) {
+      sigaction(SIGALRM, &previous_, nullptr);
+    }
+  }
+
+  // Determines if the handler was installed and the timer was set.
+  bool Armed() const { return timer_set_; }
+
+private:
+  struct sigaction previous_;
+  bool handler_installed_;
+  bool timer_set_;
+
+  // Not copyable.
+  ScopedAlarm(const ScopedAlarm &);
+  ScopedAlarm &operator=(const ScopedAlarm &);
+};
+
+TEST(IsrErrorQueueStressTest, PushesFromSignalHandler) {
+  static_assert(ATOMIC_INT_LOCK_FREE == 2,
+                "the signal handler needs a lock-free counter");
+  const int kSignals = 5000;
+  int popped = 0;
+  int last = -1;
+  {
+    ScopedAlarm alarm(PushFromSignalHandler, 20);
+    ASSERT_TRUE(alarm.Armed());
+    while (signal_pushes.load(std::memory_order_relaxed) < kSignals) {
+      Error error;
+      while (signal_queue.Pop(&error)) {
+        ASSERT_EQ(Error::INTERNAL_ERROR, error.CanonicalCode());
+        ASSERT_EQ(kLibraryNumber, error.LibraryNumber());
+        ASSERT_GT(error.ErrorNumber(), last);
+        last = error.ErrorNumber();
+        ++popped;
+      }
+    }
+  }
+
+  Error error;
+  while (signal_queue.Pop(&error)) {
+    ASSERT_GT(error.ErrorNumber(), last);
+    last = error.ErrorNumber();
+    ++popped;
+  }
+
+  // Every push was either popped or counted as an overflow.
+  EXPECT_EQ(signal_pushes.load(), popped + signal_queue.Overflows());
+}
+
+} // namespace
+} // namespace error
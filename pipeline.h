@@ -0,0 +1,193 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Composes functions returning ::error::ErrorOr<T> into stages that process
+// batches of samples.
+#ifndef ARDUINO_ERROR_PIPELINE_H
+#define ARDUINO_ERROR_PIPELINE_H
+
+#ifdef NATIVE_BUILD
+
+#include "error.h"
+#include "error_or.h"
+
+#else // NATIVE_BUILD
+
+#include <Error.h>
+#include <Error_or.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace internal {
+
+template <int BatchSize, typename Input, typename... Stages>
+class PipelineStages;
+
+} // namespace internal
+
+// Runs a chain of stages over batches of up to BatchSize inputs.
+//
+// Each stage is a function or a function object that takes the output of the
+// previous stage by const reference and returns ErrorOr<T> or a plain value.
+// Every stage processes the whole batch before the next stage starts, so the
+// loop over the batch stays in one function. An input for which a stage
+// fails keeps its error in the following stages, which skip it, while the
+// other inputs of the batch are still processed. Function objects and lambdas
+// can be inlined into the loop over the batch, plain functions are called
+// through a pointer.
+//
+// The outputs of the intermediate stages are kept in buffers owned by the
+// pipeline and reused for every batch, so processing doesn't allocate. Each
+// intermediate stage needs BatchSize * sizeof(ErrorOr<T>) bytes, which should
+// be kept in mind on boards with little RAM. The value types must be default
+// constructible and copyable.
+//
+// Example use:
+//   ErrorOr<int> Calibrate(const int &raw) { ... }
+//   ErrorOr<float> ToCelsius(const int &calibrated) { ... }
+//
+//   auto pipeline = MakePipeline<int, 32>(Calibrate, ToCelsius);
+//   ErrorOr<float> temperatures[32];
+//   RETURN_IF_ERROR(pipeline.Process(raw_samples, 32, temperatures));
+template <typename Input, int BatchSize, typename... Stages> class Pipeline {
+public:
+  // The value type returned by the last stage.
+  typedef typename internal::PipelineStages<BatchSize, Input,
+                                            Stages...>::Output Output;
+
+  explicit Pipeline(Stages... stages);
+
+  // Passes the inputs through all stages and stores the result for each input
+  // in the outputs, either the value returned by the last stage or the first
+  // error returned for the input. Returns Error::INVALID_ARGUMENT if count is
+  // negative or larger than BatchSize.
+  Error Process(const Input *inputs, int count, ErrorOr<Output> *outputs);
+
+private:
+  internal::PipelineStages<BatchSize, Input, Stages...> stages_;
+};
+
+// Creates a pipeline with the stage types deduced from the arguments.
+template <typename Input, int BatchSize, typename... Stages>
+Pipeline<Input, BatchSize, Stages...> MakePipeline(Stages... stages);
+
+//
+// Implementation details of the Pipeline class.
+//
+
+namespace internal {
+
+// Like std::declval(), which isn't available on Arduino. Only usable in
+// unevaluated expressions.
+template <typename T> T &&DeclVal();
+
+// Defines type as T, or as the value type if T is ErrorOr<value type>.
+template <typename T> struct ValueType { typedef T type; };
+template <typename T> struct ValueType<ErrorOr<T>> { typedef T type; };
+
+// Defines type as the value type of the Stage called with a const Input &.
+template <typename Stage, typename Input> struct StageOutput {
+  typedef typename ValueType<decltype(
+      DeclVal<Stage &>()(DeclVal<const Input &>()))>::type type;
+};
+
+// Calls the stage with the input, or passes the error of a failed input on.
+template <typename Output, typename Stage, typename Input>
+inline ErrorOr<Output> ApplyStage(Stage &stage, const Input &input) {
+  return stage(input);
+}
+
+template <typename Output, typename Stage, typename Input>
+inline ErrorOr<Output> ApplyStage(Stage &stage, const ErrorOr<Input> &input) {
+  return input.Ok() ? ErrorOr<Output>(stage(input.ValueOrDie()))
+                    : ErrorOr<Output>(input.GetError());
+}
+
+// Runs the stage over the batch.
+template <typename Output, typename Stage, typename Element>
+inline void RunStage(Stage &stage, const Element *inputs, int count,
+                     ErrorOr<Output> *outputs) {
+  for (int i = 0; i < count; ++i) {
+    outputs[i] = ApplyStage<Output>(stage, inputs[i]);
+  }
+}
+
+// The stages of a pipeline, stored recursively. Input is the value type
+// passed to the first stage.
+template <int BatchSize, typename Input, typename Stage>
+class PipelineStages<BatchSize, Input, Stage> {
+public:
+  typedef typename StageOutput<Stage, Input>::type Output;
+
+  explicit PipelineStages(Stage stage) : stage_(stage) {}
+
+  // Element is either Input or ErrorOr<Input>.
+  template <typename Element>
+  void Run(const Element *inputs, int count, ErrorOr<Output> *outputs) {
+    RunStage(stage_, inputs, count, outputs);
+  }
+
+private:
+  Stage stage_;
+};
+
+template <int BatchSize, typename Input, typename Stage, typename... Rest>
+class PipelineStages<BatchSize, Input, Stage, Rest...> {
+  typedef typename StageOutput<Stage, Input>::type Intermediate;
+  typedef PipelineStages<BatchSize, Intermediate, Rest...> Tail;
+
+public:
+  typedef typename Tail::Output Output;
+
+  PipelineStages(Stage stage, Rest... rest) : stage_(stage), tail_(rest...) {}
+
+  template <typename Element>
+  void Run(const Element *inputs, int count, ErrorOr<Output> *outputs) {
+    RunStage(stage_, inputs, count, buffer_);
+    tail_.Run(buffer_, count, outputs);
+  }
+
+private:
+  Stage stage_;
+  ErrorOr<Intermediate> buffer_[BatchSize];
+  Tail tail_;
+};
+
+} // namespace internal
+
+template <typename Input, int BatchSize, typename... Stages>
+inline Pipeline<Input, BatchSize, Stages...>::Pipeline(Stages... stages)
+    : stages_(stages...) {}
+
+template <typename Input, int BatchSize, typename... Stages>
+inline Error Pipeline<Input, BatchSize, Stages...>::Process(
+    const Input *inputs, int count, ErrorOr<Output> *outputs) {
+  if (count < 0 || count > BatchSize) {
+    return Error::INVALID_ARGUMENT;
+  }
+  stages_.Run(inputs, count, outputs);
+  return Error::OK;
+}
+
+template <typename Input, int BatchSize, typename... Stages>
+inline Pipeline<Input, BatchSize, Stages...> MakePipeline(Stages... stages) {
+  return Pipeline<Input, BatchSize, Stages...>(stages...);
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_PIPELINE_H
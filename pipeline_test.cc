@@ -0,0 +1,123 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pipeline.h"
+
+#include "error.h"
+#include "error_or.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::IsOkAndHolds;
+
+const int kBatchSize = 8;
+
+ErrorOr<int> Double(const int &value) { return value * 2; }
+
+// Fails for negative values.
+ErrorOr<int> CheckPositive(const int &value) {
+  if (value < 0) {
+    return Error(Error::OUT_OF_RANGE, 0, value);
+  }
+  return value;
+}
+
+ErrorOr<float> Halve(const int &value) { return value / 2.0f; }
+
+TEST(PipelineTest, RunsSingleStage) {
+  auto pipeline = MakePipeline<int, kBatchSize>(Double);
+  const int inputs[] = {1, 2, 3};
+  ErrorOr<int> outputs[kBatchSize];
+  ASSERT_OK(pipeline.Process(inputs, 3, outputs));
+  EXPECT_THAT(outputs[0], IsOkAndHolds(2));
+  EXPECT_THAT(outputs[1], IsOkAndHolds(4));
+  EXPECT_THAT(outputs[2], IsOkAndHolds(6));
+}
+
+TEST(PipelineTest, ComposesStages) {
+  auto pipeline = MakePipeline<int, kBatchSize>(Double, CheckPositive, Halve);
+  const int inputs[] = {1, 2, 3};
+  ErrorOr<float> outputs[kBatchSize];
+  ASSERT_OK(pipeline.Process(inputs, 3, outputs));
+  EXPECT_THAT(outputs[0], IsOkAndHolds(1.0f));
+  EXPECT_THAT(outputs[1], IsOkAndHolds(2.0f));
+  EXPECT_THAT(outputs[2], IsOkAndHolds(3.0f));
+}
+
+TEST(PipelineTest, KeepsErrorsOfSingleInputs) {
+  int halved = 0;
+  auto count_halved = [&halved](const int &value) -> ErrorOr<float> {
+    ++halved;
+    return value / 2.0f;
+  };
+  auto pipeline =
+      MakePipeline<int, kBatchSize>(CheckPositive, Double, count_halved);
+  const int inputs[] = {1, -2, 3, -4};
+  ErrorOr<float> outputs[kBatchSize];
+  ASSERT_OK(pipeline.Process(inputs, 4, outputs));
+  EXPECT_THAT(outputs[0], IsOkAndHolds(1.0f));
+  EXPECT_THAT(outputs[1], ErrorIs(Error::OUT_OF_RANGE, 0, -2));
+  EXPECT_THAT(outputs[2], IsOkAndHolds(3.0f));
+  EXPECT_THAT(outputs[3], ErrorIs(Error::OUT_OF_RANGE, 0, -4));
+  // The later stages skip the failed inputs.
+  EXPECT_EQ(2, halved);
+}
+
+TEST(PipelineTest, AcceptsStagesReturningPlainValues) {
+  auto pipeline = MakePipeline<int, kBatchSize>(
+      CheckPositive, [](const int &value) { return value + 1; });
+  const int inputs[] = {1, -1};
+  ErrorOr<int> outputs[kBatchSize];
+  ASSERT_OK(pipeline.Process(inputs, 2, outputs));
+  EXPECT_THAT(outputs[0], IsOkAndHolds(2));
+  EXPECT_THAT(outputs[1], ErrorIs(Error::OUT_OF_RANGE));
+}
+
+TEST(PipelineTest, StagesKeepStateAcrossBatches) {
+  int total = 0;
+  auto running_sum = [total](const int &value) mutable -> ErrorOr<int> {
+    total += value;
+    return total;
+  };
+  auto pipeline = MakePipeline<int, kBatchSize>(running_sum);
+  const int inputs[] = {1, 2, 3};
+  ErrorOr<int> outputs[kBatchSize];
+  ASSERT_OK(pipeline.Process(inputs, 3, outputs));
+  ASSERT_OK(pipeline.Process(inputs, 1, outputs));
+  EXPECT_THAT(outputs[0], IsOkAndHolds(7));
+}
+
+TEST(PipelineTest, ProcessesEmptyBatch) {
+  auto pipeline = MakePipeline<int, kBatchSize>(Double, Halve);
+  ErrorOr<float> outputs[kBatchSize];
+  EXPECT_OK(pipeline.Process(nullptr, 0, outputs));
+}
+
+TEST(PipelineTest, RejectsInvalidCount) {
+  auto pipeline = MakePipeline<int, kBatchSize>(Double, Halve);
+  const int inputs[kBatchSize + 1] = {};
+  ErrorOr<float> outputs[kBatchSize + 1];
+  EXPECT_THAT(pipeline.Process(inputs, kBatchSize + 1, outputs),
+              ErrorIs(Error::INVALID_ARGUMENT));
+  EXPECT_THAT(pipeline.Process(inputs, -1, outputs),
+              ErrorIs(Error::INVALID_ARGUMENT));
+}
+
+} // namespace
+} // namespace error
@@ -0,0 +1,115 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef NATIVE_BUILD
+
+#include "retry.h"
+
+#else // NATIVE_BUILD
+
+#include <Retry.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace {
+
+const int kDefaultMaxAttempts = 3;
+const int64_t kDefaultInitialBackoffMicros = 1000;
+const int64_t kDefaultMaxBackoffMicros = 1000000;
+const int kDefaultBackoffMultiplier = 2;
+const int kDefaultJitterPercent = 20;
+
+bool Matches(const RetryRule &rule, const Error &error) {
+  return rule.canonical_code == error.CanonicalCode() &&
+         (rule.library_number == kUnspecified ||
+          rule.library_number == error.LibraryNumber()) &&
+         (rule.error_number == kUnspecified ||
+          rule.error_number == error.ErrorNumber());
+}
+
+// Advances the xorshift32 generator and returns the next value.
+uint32_t NextRandom(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+} // namespace
+
+RetryPolicy::RetryPolicy(const RetryRule *retryable_rules,
+                         int num_retryable_rules)
+    : rules(retryable_rules), num_rules(num_retryable_rules),
+      max_attempts(kDefaultMaxAttempts),
+      initial_backoff_micros(kDefaultInitialBackoffMicros),
+      max_backoff_micros(kDefaultMaxBackoffMicros),
+      backoff_multiplier(kDefaultBackoffMultiplier),
+      jitter_percent(kDefaultJitterPercent), deadline_micros(0) {}
+
+bool IsRetryable(const RetryPolicy &policy, const Error &error) {
+  for (int i = 0; i < policy.num_rules; ++i) {
+    if (Matches(policy.rules[i], error)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace internal {
+
+// The clock is only read up front when the policy has a deadline, so that a
+// first call that succeeds doesn't pay for it.
+RetryState::RetryState(const RetryPolicy &policy, Clock *clock)
+    : policy_(policy), clock_(clock),
+      start_micros_(policy.deadline_micros > 0 ? clock->NowMicros() : 0),
+      backoff_micros_(policy.initial_backoff_micros), attempts_(1),
+      random_state_(0) {}
+
+RetryState::~RetryState() {}
+
+bool RetryState::BackoffAfterError(const Error &error) {
+  if (attempts_ >= policy_.max_attempts || !IsRetryable(policy_, error)) {
+    return false;
+  }
+
+  if (random_state_ == 0) {
+    random_state_ = static_cast<uint32_t>(clock_->NowMicros()) | 1;
+  }
+  int64_t sleep_micros = backoff_micros_;
+  int64_t max_jitter_micros = sleep_micros * policy_.jitter_percent / 100;
+  if (max_jitter_micros > 0) {
+    sleep_micros -= NextRandom(&random_state_) % (max_jitter_micros + 1);
+  }
+
+  if (policy_.deadline_micros > 0 &&
+      clock_->NowMicros() + sleep_micros >=
+          start_micros_ + policy_.deadline_micros) {
+    return false;
+  }
+
+  clock_->SleepMicros(sleep_micros);
+  attempts_++;
+  backoff_micros_ *= policy_.backoff_multiplier;
+  if (backoff_micros_ > policy_.max_backoff_micros) {
+    backoff_micros_ = policy_.max_backoff_micros;
+  }
+  return true;
+}
+
+} // namespace internal
+
+} // namespace error
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Retries functions that return ::error::Error or ::error::ErrorOr<T>.
+#ifndef ARDUINO_ERROR_RETRY_H
+#define ARDUINO_ERROR_RETRY_H
+
+#include <stdint.h>
+
+#ifdef NATIVE_BUILD
+
+#include "clock.h"
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Clock.h>
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+
+// Classifies errors as retryable. An error matches the rule if it has the
+// same canonical code and the same library and error numbers. A library or
+// error number set to kUnspecified in the rule matches any value.
+//
+// Rules are meant to be defined in constant tables, e.g.:
+//   constexpr RetryRule kRetryable[] = {
+//       {Error::INTERNAL_ERROR, kUnspecified, kUnspecified},
+//       {Error::UNKNOWN, kMyIoLibrary, kUnspecified},
+//   };
+struct RetryRule {
+  Error::Code canonical_code;
+  int library_number;
+  int error_number;
+};
+
+// Determines how errors are retried.
+struct RetryPolicy {
+  // Creates a policy that retries errors matching any of the provided rules
+  // with the default attempts, backoff and no deadline.
+  template <int N>
+  explicit RetryPolicy(const RetryRule (&retryable_rules)[N]);
+  RetryPolicy(const RetryRule *retryable_rules, int num_retryable_rules);
+
+  // The table of retryable errors, not owned.
+  const RetryRule *rules;
+  int num_rules;
+
+  // The maximum number of times the function is called, including the first
+  // call. Defaults to 3.
+  int max_attempts;
+
+  // The time to wait before the first retry, defaults to 1 millisecond.
+  int64_t initial_backoff_micros;
+
+  // The upper bound of the time to wait between two attempts, defaults to 1
+  // second.
+  int64_t max_backoff_micros;
+
+  // Each subsequent backoff is this many times longer. Defaults to 2.
+  int backoff_multiplier;
+
+  // Each backoff is randomly shortened by up to this percentage so that
+  // clients failing at the same time don't retry at the same time. Defaults to
+  // 20.
+  int jitter_percent;
+
+  // The time budget in microseconds measured from the first call. No retry is
+  // attempted if it wouldn't start before the deadline. Zero or a negative
+  // value means no deadline, which is the default.
+  int64_t deadline_micros;
+};
+
+// Determines if the error matches any of the rules of the policy.
+bool IsRetryable(const RetryPolicy &policy, const Error &error);
+
+// Calls the function until it succeeds, it returns an error that isn't
+// retryable according to the policy, the attempts are exhausted or the
+// deadline is reached. Waits with exponential backoff and jitter between the
+// attempts. Returns the result of the last call.
+//
+// The function must return ::error::Error or ::error::ErrorOr<T>.
+//
+// Example use:
+//   ErrorOr<int> ReadSensor() { ... }
+//
+//   ErrorOr<int> value = Retry(policy, ReadSensor);
+template <typename Function>
+auto Retry(const RetryPolicy &policy, Clock *clock, Function function)
+    -> decltype(function());
+
+// Same as above, but uses the SystemClock().
+template <typename Function>
+auto Retry(const RetryPolicy &policy, Function function)
+    -> decltype(function());
+
+//
+// Implementation details of the retry functions.
+//
+
+template <int N>
+inline RetryPolicy::RetryPolicy(const RetryRule (&retryable_rules)[N])
+    : RetryPolicy(retryable_rules, N) {}
+
+namespace internal {
+
+// Tracks the attempts of a single call to Retry(). Kept out of the template so
+// that the backoff logic isn't duplicated for each retried function.
+class RetryState {
+public:
+  RetryState(const RetryPolicy &policy, Clock *clock);
+  ~RetryState();
+
+  // Determines if the function should be called again after returning the
+  // provided error. Waits for the backoff period before returning true.
+  bool ShouldRetry(const Error &error);
+
+private:
+  // Handles the case when the function failed.
+  bool BackoffAfterError(const Error &error);
+
+  const RetryPolicy &policy_;
+  Clock *clock_;
+  // Only set if the policy has a deadline.
+  int64_t start_micros_;
+  int64_t backoff_micros_;
+  int attempts_;
+  // Seeded from the clock before the first backoff, zero until then.
+  uint32_t random_state_;
+};
+
+inline bool RetryState::ShouldRetry(const Error &error) {
+  return !error.Ok() && BackoffAfterError(error);
+}
+
+} // namespace internal
+
+template <typename Function>
+inline auto Retry(const RetryPolicy &policy, Clock *clock, Function function)
+    -> decltype(function()) {
+  internal::RetryState state(policy, clock);
+  auto result = function();
+  while (state.ShouldRetry(result.GetError())) {
+    result = function();
+  }
+  return result;
+}
+
+template <typename Function>
+inline auto Retry(const RetryPolicy &policy, Function function)
+    -> decltype(function()) {
+  return Retry(policy, SystemClock(), function);
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_RETRY_H
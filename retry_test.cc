@@ -0,0 +1,192 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "retry.h"
+
+#include <functional>
+
+#include "error.h"
+#include "error_or.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "testing/fake_clock.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::FakeClock;
+using ::testing::error::IsOkAndHolds;
+
+const int kLibraryNumber = 3;
+const int kErrorNumber = 5;
+
+constexpr RetryRule kRetryable[] = {
+    {Error::INTERNAL_ERROR, kUnspecified, kUnspecified},
+    {Error::UNKNOWN, kLibraryNumber, kErrorNumber},
+};
+
+// Returns the queued errors one by one and then the value.
+class FlakyFunction {
+public:
+  FlakyFunction(const Error *errors, int num_errors, int value)
+      : errors_(errors), num_errors_(num_errors), value_(value), calls_(0) {}
+
+  ErrorOr<int> operator()() {
+    int call = calls_++;
+    if (call < num_errors_) {
+      return errors_[call];
+    }
+    return value_;
+  }
+
+  int Calls() const { return calls_; }
+
+private:
+  const Error *errors_;
+  int num_errors_;
+  int value_;
+  int calls_;
+};
+
+RetryPolicy NoJitterPolicy() {
+  RetryPolicy policy(kRetryable);
+  policy.jitter_percent = 0;
+  return policy;
+}
+
+TEST(IsRetryableTest, MatchesRules) {
+  RetryPolicy policy(kRetryable);
+  EXPECT_TRUE(IsRetryable(policy, Error(Error::INTERNAL_ERROR)));
+  EXPECT_TRUE(IsRetryable(policy, Error(Error::INTERNAL_ERROR, 1, 2, 3)));
+  EXPECT_TRUE(
+      IsRetryable(policy, Error(Error::UNKNOWN, kLibraryNumber, kErrorNumber)));
+  EXPECT_FALSE(IsRetryable(policy, Error(Error::UNKNOWN)));
+  EXPECT_FALSE(IsRetryable(policy, Error(Error::UNKNOWN, kLibraryNumber)));
+  EXPECT_FALSE(IsRetryable(policy, Error(Error::INVALID_ARGUMENT)));
+}
+
+TEST(RetryTest, DoesNotRetryOnSuccess) {
+  FakeClock clock;
+  FlakyFunction function(nullptr, 0, 42);
+  EXPECT_THAT(Retry(NoJitterPolicy(), &clock, std::ref(function)),
+              IsOkAndHolds(42));
+  EXPECT_EQ(1, function.Calls());
+  EXPECT_EQ(0, clock.SleepCalls());
+}
+
+TEST(RetryTest, RetriesUntilSuccess) {
+  const Error errors[] = {
+      Error(Error::INTERNAL_ERROR),
+      Error(Error::UNKNOWN, kLibraryNumber, kErrorNumber),
+  };
+  FakeClock clock;
+  FlakyFunction function(errors, 2, 42);
+  EXPECT_THAT(Retry(NoJitterPolicy(), &clock, std::ref(function)),
+              IsOkAndHolds(42));
+  EXPECT_EQ(3, function.Calls());
+  EXPECT_EQ(2, clock.SleepCalls());
+  // Backoff of 1 ms followed by 2 ms.
+  EXPECT_EQ(3000, clock.SleptMicros());
+}
+
+TEST(RetryTest, DoesNotRetryNonRetryableErrors) {
+  const Error errors[] = {Error(Error::INVALID_ARGUMENT)};
+  FakeClock clock;
+  FlakyFunction function(errors, 1, 42);
+  EXPECT_THAT(Retry(NoJitterPolicy(), &clock, std::ref(function)),
+              ErrorIs(Error::INVALID_ARGUMENT));
+  EXPECT_EQ(1, function.Calls());
+}
+
+TEST(RetryTest, ReturnsLastErrorWhenAttemptsExhausted) {
+  const Error errors[] = {
+      Error(Error::INTERNAL_ERROR, 1),
+      Error(Error::INTERNAL_ERROR, 2),
+      Error(Error::INTERNAL_ERROR, 3),
+  };
+  FakeClock clock;
+  FlakyFunction function(errors, 3, 42);
+  EXPECT_THAT(Retry(NoJitterPolicy(), &clock, std::ref(function)),
+              ErrorIs(Error::INTERNAL_ERROR, 3));
+  EXPECT_EQ(3, function.Calls());
+}
+
+TEST(RetryTest, CapsBackoff) {
+  const Error errors[] = {
+      Error(Error::INTERNAL_ERROR),
+      Error(Error::INTERNAL_ERROR),
+      Error(Error::INTERNAL_ERROR),
+  };
+  FakeClock clock;
+  FlakyFunction function(errors, 3, 42);
+  RetryPolicy policy = NoJitterPolicy();
+  policy.max_attempts = 4;
+  policy.max_backoff_micros = 1500;
+  EXPECT_THAT(Retry(policy, &clock, std::ref(function)), IsOkAndHolds(42));
+  // 1000 + 1500 + 1500.
+  EXPECT_EQ(4000, clock.SleptMicros());
+}
+
+TEST(RetryTest, StopsAtDeadline) {
+  const Error errors[] = {
+      Error(Error::INTERNAL_ERROR, 1),
+      Error(Error::INTERNAL_ERROR, 2),
+      Error(Error::INTERNAL_ERROR, 3),
+  };
+  FakeClock clock;
+  FlakyFunction function(errors, 3, 42);
+  RetryPolicy policy = NoJitterPolicy();
+  policy.max_attempts = 10;
+  // Allows the first retry after 1 ms, but not the second one after 2 more.
+  policy.deadline_micros = 2500;
+  EXPECT_THAT(Retry(policy, &clock, std::ref(function)),
+              ErrorIs(Error::INTERNAL_ERROR, 2));
+  EXPECT_EQ(2, function.Calls());
+  EXPECT_EQ(1000, clock.SleptMicros());
+}
+
+TEST(RetryTest, JitterShortensBackoff) {
+  const Error errors[] = {
+      Error(Error::INTERNAL_ERROR),
+      Error(Error::INTERNAL_ERROR),
+  };
+  FakeClock clock(12345);
+  FlakyFunction function(errors, 2, 42);
+  RetryPolicy policy(kRetryable);
+  policy.jitter_percent = 50;
+  EXPECT_THAT(Retry(policy, &clock, std::ref(function)), IsOkAndHolds(42));
+  EXPECT_GE(clock.SleptMicros(), 500 + 1000);
+  EXPECT_LE(clock.SleptMicros(), 1000 + 2000);
+}
+
+Error FailOnce(int *calls) {
+  if ((*calls)++ == 0) {
+    return Error::INTERNAL_ERROR;
+  }
+  return Error::OK;
+}
+
+TEST(RetryTest, RetriesFunctionsReturningError) {
+  FakeClock clock;
+  int calls = 0;
+  EXPECT_OK(Retry(NoJitterPolicy(), &clock, [&calls]() {
+    return FailOnce(&calls);
+  }));
+  EXPECT_EQ(2, calls);
+}
+
+} // namespace
+} // namespace error
@@ -0,0 +1,121 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "testing/allocation_tracker.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+namespace testing {
+namespace error {
+namespace {
+
+// Plain thread-local integers don't need dynamic initialization, so updating
+// them doesn't allocate from within operator new.
+thread_local uint64_t thread_allocations = 0;
+thread_local uint64_t thread_allocated_bytes = 0;
+::std::atomic<uint64_t> total_allocations(0);
+
+// Counts the allocation and allocates like the default operator new. The
+// alignment is only passed by the aligned forms of operator new, the memory
+// returned by malloc() is suitably aligned for all other allocations.
+void *Allocate(size_t size, size_t alignment = 0) {
+  ++thread_allocations;
+  thread_allocated_bytes += size;
+  total_allocations.fetch_add(1, ::std::memory_order_relaxed);
+  if (size == 0) {
+    size = 1;
+  }
+  for (;;) {
+    void *memory = nullptr;
+    if (alignment == 0) {
+      memory = malloc(size);
+    } else if (posix_memalign(&memory, alignment, size) != 0) {
+      memory = nullptr;
+    }
+    if (memory != nullptr) {
+      return memory;
+    }
+    ::std::new_handler handler = ::std::get_new_handler();
+    if (handler == nullptr) {
+      throw ::std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+} // namespace
+
+uint64_t ThreadAllocations() { return thread_allocations; }
+
+uint64_t ThreadAllocatedBytes() { return thread_allocated_bytes; }
+
+uint64_t TotalAllocations() {
+  return total_allocations.load(::std::memory_order_relaxed);
+}
+
+AllocationTracker::AllocationTracker()
+    : start_allocations_(ThreadAllocations()),
+      start_bytes_(ThreadAllocatedBytes()) {}
+
+uint64_t AllocationTracker::Allocations() const {
+  return ThreadAllocations() - start_allocations_;
+}
+
+uint64_t AllocationTracker::AllocatedBytes() const {
+  return ThreadAllocatedBytes() - start_bytes_;
+}
+
+} // namespace error
+} // namespace testing
+
+// The other forms of operator new and delete call these by default.
+void *operator new(size_t size) { return ::testing::error::Allocate(size); }
+
+void *operator new[](size_t size) { return ::testing::error::Allocate(size); }
+
+void operator delete(void *memory) noexcept { free(memory); }
+
+void operator delete[](void *memory) noexcept { free(memory); }
+
+#ifdef __cpp_sized_deallocation
+
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+void operator delete[](void *memory, size_t) noexcept { free(memory); }
+
+#endif // __cpp_sized_deallocation
+
+#ifdef __cpp_aligned_new
+
+// Used for types aligned beyond alignof(std::max_align_t) since C++17.
+void *operator new(size_t size, ::std::align_val_t alignment) {
+  return ::testing::error::Allocate(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, ::std::align_val_t alignment) {
+  return ::testing::error::Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *memory, ::std::align_val_t) noexcept {
+  free(memory);
+}
+
+void operator delete[](void *memory, ::std::align_val_t) noexcept {
+  free(memory);
+}
+
+#endif // __cpp_aligned_new
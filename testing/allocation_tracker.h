@@ -0,0 +1,107 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Counts heap allocations, so that tests can verify that code doesn't
+// allocate. Linking this library replaces the global operator new and
+// operator delete of the test binary.
+#ifndef ARDUINO_ERROR_TESTING_ALLOCATION_TRACKER_H
+#define ARDUINO_ERROR_TESTING_ALLOCATION_TRACKER_H
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+
+namespace testing {
+namespace error {
+
+// Returns the number of allocations made by the calling thread since it
+// started.
+uint64_t ThreadAllocations();
+
+// Returns the number of bytes requested by the allocations of the calling
+// thread since it started.
+uint64_t ThreadAllocatedBytes();
+
+// Returns the number of allocations made by all threads since the program
+// started.
+uint64_t TotalAllocations();
+
+// Counts the allocations made by the calling thread during its lifetime.
+// Allocations made by other threads, like the background threads of the code
+// under test or of the test framework, aren't counted.
+//
+// Only calls of operator new are counted. Since C++14 the compiler may remove
+// a new expression whose result is unused or deleted right away, and GCC does
+// with optimizations enabled, so such allocations aren't counted either. A
+// test that expects an allocation has to let the pointer escape, e.g. by
+// storing it into a volatile variable.
+//
+// Example use:
+//   AllocationTracker tracker;
+//   Error error = Forward();
+//   EXPECT_EQ(0u, tracker.Allocations());
+class AllocationTracker {
+public:
+  AllocationTracker();
+
+  // Returns the number of allocations made by the thread since the tracker
+  // was created.
+  uint64_t Allocations() const;
+
+  // Returns the number of bytes requested by these allocations.
+  uint64_t AllocatedBytes() const;
+
+private:
+  // Not copyable.
+  AllocationTracker(const AllocationTracker &);
+  AllocationTracker &operator=(const AllocationTracker &);
+
+  uint64_t start_allocations_;
+  uint64_t start_bytes_;
+};
+
+// Macros verifying that the statements don't allocate on the calling thread.
+// Statements containing commas can be passed without extra parentheses. Like
+// AllocationTracker, they don't see allocations the compiler removed.
+//
+// Example use:
+//   EXPECT_NO_ALLOCATIONS({
+//     ErrorOr<int> value = Parse(input, 10);
+//     EXPECT_TRUE(value.Ok());
+//   });
+#define EXPECT_NO_ALLOCATIONS(...)                                             \
+  CHECK_NO_ALLOCATIONS_IMPL(EXPECT_EQ, __VA_ARGS__)
+#define ASSERT_NO_ALLOCATIONS(...)                                             \
+  CHECK_NO_ALLOCATIONS_IMPL(ASSERT_EQ, __VA_ARGS__)
+
+//
+// Implementation details for the NO_ALLOCATIONS macros.
+//
+
+#define CHECK_NO_ALLOCATIONS_IMPL(check, ...)                                  \
+  do {                                                                         \
+    ::testing::error::AllocationTracker allocation_tracker;                    \
+    __VA_ARGS__;                                                               \
+    /* Read before the failure message allocates. */                          \
+    const uint64_t allocated_bytes = allocation_tracker.AllocatedBytes();      \
+    check(0u, allocation_tracker.Allocations())                                \
+        << "Allocated " << allocated_bytes << " bytes in: " #__VA_ARGS__;      \
+  } while (false)
+
+} // namespace error
+} // namespace testing
+
+#endif // ARDUINO_ERROR_TESTING_ALLOCATION_TRACKER_H
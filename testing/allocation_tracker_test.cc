@@ -0,0 +1,99 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "testing/allocation_tracker.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest-spi.h"
+#include "gtest/gtest.h"
+
+namespace testing {
+namespace error {
+namespace {
+
+// Keeps the compiler from removing the allocations of the tests, which it may
+// do for unused new expressions since C++14.
+void *volatile escaped;
+
+template <typename T> T *Escape(T *pointer) {
+  escaped = pointer;
+  return pointer;
+}
+
+TEST(AllocationTrackerTest, CountsAllocations) {
+  AllocationTracker tracker;
+  EXPECT_EQ(0u, tracker.Allocations());
+  std::unique_ptr<int> value(Escape(new int(1)));
+  std::unique_ptr<char[]> buffer(Escape(new char[100]));
+  EXPECT_EQ(2u, tracker.Allocations());
+  EXPECT_EQ(sizeof(int) + 100, tracker.AllocatedBytes());
+}
+
+#ifdef __cpp_aligned_new
+
+struct alignas(64) CacheLine {
+  char bytes[64];
+};
+
+TEST(AllocationTrackerTest, CountsOverAlignedAllocations) {
+  AllocationTracker tracker;
+  std::unique_ptr<CacheLine> line(Escape(new CacheLine()));
+  std::unique_ptr<CacheLine[]> lines(Escape(new CacheLine[2]));
+  EXPECT_EQ(2u, tracker.Allocations());
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(line.get()) % 64);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(lines.get()) % 64);
+}
+
+#endif // __cpp_aligned_new
+
+TEST(AllocationTrackerTest, DoesNotCountDeallocations) {
+  int *value = Escape(new int(1));
+  AllocationTracker tracker;
+  delete value;
+  EXPECT_EQ(0u, tracker.Allocations());
+}
+
+TEST(AllocationTrackerTest, CountsOnlyTheCallingThread) {
+  AllocationTracker tracker;
+  const uint64_t total = TotalAllocations();
+  std::thread thread([] { delete Escape(new int(1)); });
+  thread.join();
+  // Starting the thread allocates on the calling thread.
+  const uint64_t allocations = tracker.Allocations();
+  EXPECT_GT(TotalAllocations(), total + allocations);
+  EXPECT_LE(ThreadAllocations(), TotalAllocations());
+}
+
+TEST(AllocationTrackerTest, PassesWithoutAllocations) {
+  EXPECT_NO_ALLOCATIONS({
+    int values[] = {1, 2, 3};
+    EXPECT_EQ(2, values[1]);
+  });
+  ASSERT_NO_ALLOCATIONS(int value = 1; EXPECT_EQ(1, value));
+}
+
+TEST(AllocationTrackerTest, FailsOnAllocation) {
+  EXPECT_NONFATAL_FAILURE(EXPECT_NO_ALLOCATIONS(delete Escape(new int(1))),
+                          "Allocated 4 bytes in: delete Escape(new int(1))");
+  EXPECT_FATAL_FAILURE(ASSERT_NO_ALLOCATIONS(delete Escape(new int(1))),
+                       "Allocated 4 bytes");
+}
+
+} // namespace
+} // namespace error
+} // namespace testing
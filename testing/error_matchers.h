@@ -25,6 +25,7 @@
 #include "error_or.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "testing/error_or_printers.h"
 
 using ::testing::MakePolymorphicMatcher;
 using ::testing::MatchResultListener;
@@ -50,7 +51,8 @@ public:
   ~ErrorMatcher();
 
   template <typename ErrorType>
-  bool MatchAndExplain(ErrorType error, MatchResultListener *listener) const;
+  bool MatchAndExplain(const ErrorType &error,
+                       MatchResultListener *listener) const;
   void DescribeTo(::std::ostream *os) const;
   void DescribeNegationTo(::std::ostream *os) const;
 
@@ -93,8 +95,8 @@ inline ErrorMatcher::ErrorMatcher(::error::Error::Code expected_code)
 inline ErrorMatcher::~ErrorMatcher() {}
 
 template <typename ErrorType>
-inline bool ErrorMatcher::MatchAndExplain(ErrorType error_type,
-                                          MatchResultListener *listener) const {
+inline bool ErrorMatcher::MatchAndExplain(const ErrorType &error_type,
+                                          MatchResultListener *) const {
   const ::error::Error &error = error_type.GetError();
   ::error::Error expected_error = expected_error_;
 
@@ -142,14 +144,15 @@ inline bool ErrorMatcher::IgnoreLibraryErrorAndSubcode() const {
 }
 
 // A matcher that matches the value of type T in an error::ErrorOr<T> type using
-// the provided inner matcher.
+// the provided inner matcher. The value is matched by reference, so T can be
+// large or move-only.
 template <typename InnerMatcher> class ErrorOrValueMatcher {
 public:
   explicit ErrorOrValueMatcher(InnerMatcher inner_matcher);
   ~ErrorOrValueMatcher();
 
   template <typename T>
-  bool MatchAndExplain(::error::ErrorOr<T> error_or,
+  bool MatchAndExplain(const ::error::ErrorOr<T> &error_or,
                        MatchResultListener *listener) const;
 
   void DescribeTo(::std::ostream *os) const;
@@ -174,14 +177,20 @@ inline ErrorOrValueMatcher<InnerMatcher>::~ErrorOrValueMatcher() {}
 template <typename InnerMatcher>
 template <typename T>
 inline bool ErrorOrValueMatcher<InnerMatcher>::MatchAndExplain(
-    ::error::ErrorOr<T> error_or, MatchResultListener *listener) const {
+    const ::error::ErrorOr<T> &error_or, MatchResultListener *listener) const {
   if (!error_or.Ok()) {
     return false;
   }
 
-  StringMatchResultListener inner_listener;
-  Matcher<T> matcher = inner_matcher_;
+  const Matcher<const T &> matcher =
+      ::testing::SafeMatcherCast<const T &>(inner_matcher_);
 
+  // Skips the explanation unless googletest is going to print it.
+  if (!listener->IsInterested()) {
+    return matcher.Matches(error_or.ValueOrDie());
+  }
+
+  StringMatchResultListener inner_listener;
   *listener << "inner_matcher: ";
   matcher.DescribeTo(listener->stream());
 
@@ -14,6 +14,10 @@
 
 #include "testing/error_matchers.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "error.h"
 #include "error_or.h"
 #include "gtest/gtest.h"
@@ -163,6 +167,63 @@ TEST(ErrorOrValueMatcher, MatchesValue) {
   EXPECT_THAT(error_or_value, Not(IsOkAndHolds(Eq(0))));
 }
 
+TEST(ErrorOrValueMatcher, MatchesWithoutListener) {
+  auto error_or_value = ReturnValue();
+  EXPECT_TRUE(Value(error_or_value, IsOkAndHolds(kValue)));
+  EXPECT_FALSE(Value(error_or_value, IsOkAndHolds(Eq(0))));
+}
+
+TEST(ErrorOrValueMatcher, ExplainsInnerMatcher) {
+  StringMatchResultListener listener;
+  EXPECT_FALSE(
+      ExplainMatchResult(IsOkAndHolds(Eq(0)), ReturnValue(), &listener));
+  EXPECT_THAT(listener.str(), HasSubstr("inner_matcher: is equal to 0"));
+}
+
+TEST(ErrorOrValueMatcher, MatchesMoveOnlyValue) {
+  ErrorOr<std::unique_ptr<int>> error_or_value(
+      std::unique_ptr<int>(new int(kValue)));
+  EXPECT_THAT(error_or_value, IsOkAndHolds(Pointee(kValue)));
+  EXPECT_THAT(error_or_value, Not(IsOkAndHolds(IsNull())));
+}
+
+// Counts the copies made of its instances.
+class CopyCounter {
+public:
+  CopyCounter() {}
+  CopyCounter(const CopyCounter &) { ++copies; }
+  CopyCounter &operator=(const CopyCounter &) {
+    ++copies;
+    return *this;
+  }
+
+  bool operator==(const CopyCounter &) const { return true; }
+
+  static int copies;
+};
+
+int CopyCounter::copies = 0;
+
+void PrintTo(const CopyCounter &, std::ostream *os) { *os << "CopyCounter"; }
+
+TEST(ErrorOrValueMatcher, DoesNotCopyValue) {
+  ErrorOr<CopyCounter> error_or_value = CopyCounter();
+  CopyCounter expected;
+  CopyCounter::copies = 0;
+  EXPECT_THAT(error_or_value, IsOk());
+  EXPECT_THAT(error_or_value, IsOkAndHolds(Ref(error_or_value.ValueOrDie())));
+  EXPECT_FALSE(Value(error_or_value, Not(IsOkAndHolds(A<CopyCounter>()))));
+  EXPECT_EQ(0, CopyCounter::copies);
+}
+
+TEST(ErrorOrValueMatcher, MatchesLargeValue) {
+  const size_t kSize = 16 * 1024 * 1024;
+  ErrorOr<std::vector<char>> error_or_value(std::vector<char>(kSize, 'x'));
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_THAT(error_or_value, IsOkAndHolds(SizeIs(kSize)));
+  }
+}
+
 } // namespace
 } // namespace error
 } // namespace testing
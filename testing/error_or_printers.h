@@ -0,0 +1,48 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Googletest printers for the error::ErrorOr type.
+// Kept apart from error_or.h, so that code using ErrorOr doesn't need to
+// parse googletest. Included by testing/error_matchers.h.
+#ifndef ARDUINO_ERROR_TESTING_ERROR_OR_PRINTERS_H
+#define ARDUINO_ERROR_TESTING_ERROR_OR_PRINTERS_H
+
+#include <ostream>
+
+#include "error.h"
+#include "error_or.h"
+#include "gtest/gtest.h"
+
+namespace error {
+
+// Prints a human readable representation of ErrorOr for use in tests.
+// Found by argument-dependent lookup, so it must be included by every test
+// that wants googletest to print ErrorOr values.
+template <typename T>
+void PrintTo(const ErrorOr<T> &error_or, ::std::ostream *os) {
+  *os << "ErrorOr<T>(";
+  if (error_or.Ok()) {
+    *os << "with value " << ::testing::PrintToString(error_or.ValueOrDie())
+        << ")";
+  } else {
+    *os << "with error " << ::testing::PrintToString(error_or.GetError());
+    *os << ")";
+  }
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_TESTING_ERROR_OR_PRINTERS_H
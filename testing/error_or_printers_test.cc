@@ -0,0 +1,40 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "testing/error_or_printers.h"
+
+#include <string>
+
+#include "error.h"
+#include "error_or.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+TEST(ErrorOrPrintersTest, PrintsValue) {
+  ErrorOr<int> error_or_int(42);
+  EXPECT_EQ("ErrorOr<T>(with value 42)",
+            ::testing::PrintToString(error_or_int));
+}
+
+TEST(ErrorOrPrintersTest, PrintsError) {
+  const Error error(Error::INTERNAL_ERROR, 1, 2, 3);
+  ErrorOr<int> error_or_int(error);
+  EXPECT_EQ("ErrorOr<T>(with error " + ::testing::PrintToString(error) + ")",
+            ::testing::PrintToString(error_or_int));
+}
+
+} // namespace
+} // namespace error
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A fake implementation of ::error::Clock for deterministic unit tests.
+#ifndef ARDUINO_ERROR_TESTING_FAKE_CLOCK_H
+#define ARDUINO_ERROR_TESTING_FAKE_CLOCK_H
+
+#include <stdint.h>
+
+#include "clock.h"
+
+namespace testing {
+namespace error {
+
+// A clock that only moves when told to. Sleeping advances the time instantly
+// by the requested amount.
+class FakeClock : public ::error::Clock {
+public:
+  // Creates a clock starting at the provided time.
+  explicit FakeClock(int64_t start_micros = 0);
+  ~FakeClock() override;
+
+  int64_t NowMicros() override;
+  void SleepMicros(int64_t micros) override;
+
+  // Moves the time forward by the specified number of microseconds.
+  void AdvanceMicros(int64_t micros);
+
+  // Returns the number of times SleepMicros was called.
+  int SleepCalls() const;
+
+  // Returns the total number of microseconds passed to SleepMicros.
+  int64_t SleptMicros() const;
+
+private:
+  int64_t now_micros_;
+  int sleep_calls_;
+  int64_t slept_micros_;
+};
+
+//
+// Implementation details of the FakeClock class.
+//
+
+inline FakeClock::FakeClock(int64_t start_micros)
+    : now_micros_(start_micros), sleep_calls_(0), slept_micros_(0) {}
+
+inline FakeClock::~FakeClock() {}
+
+inline int64_t FakeClock::NowMicros() { return now_micros_; }
+
+inline void FakeClock::SleepMicros(int64_t micros) {
+  sleep_calls_++;
+  slept_micros_ += micros;
+  now_micros_ += micros;
+}
+
+inline void FakeClock::AdvanceMicros(int64_t micros) { now_micros_ += micros; }
+
+inline int FakeClock::SleepCalls() const { return sleep_calls_; }
+
+inline int64_t FakeClock::SleptMicros() const { return slept_micros_; }
+
+} // namespace error
+} // namespace testing
+
+#endif // ARDUINO_ERROR_TESTING_FAKE_CLOCK_H
@@ -0,0 +1,66 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef NATIVE_BUILD
+
+#include "thread_error_context.h"
+
+#else // NATIVE_BUILD
+
+#include <Thread_error_context.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+namespace {
+
+// The sticky error. Arduino boards run a single thread of execution, so a
+// global is sufficient there.
+#ifdef NATIVE_BUILD
+thread_local Error sticky_error;
+#else  // NATIVE_BUILD
+Error sticky_error;
+#endif // NATIVE_BUILD
+
+} // namespace
+
+void ThreadErrorContext::Record(const Error &error) {
+  if (sticky_error.Ok()) {
+    sticky_error = error;
+  }
+}
+
+bool ThreadErrorContext::Ok() { return sticky_error.Ok(); }
+
+const Error &ThreadErrorContext::Get() { return sticky_error; }
+
+void ThreadErrorContext::Clear() { sticky_error = Error(Error::OK); }
+
+ThreadErrorContext::Scope::Scope() : enclosing_error_(sticky_error) {
+  Clear();
+}
+
+ThreadErrorContext::Scope::~Scope() {
+  if (!enclosing_error_.Ok()) {
+    sticky_error = enclosing_error_;
+  }
+}
+
+Error ThreadErrorContext::Scope::Release() {
+  Error error = sticky_error;
+  Clear();
+  return error;
+}
+
+} // namespace error
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// An errno-style sticky error for functions called from tight loops.
+#ifndef ARDUINO_ERROR_THREAD_ERROR_CONTEXT_H
+#define ARDUINO_ERROR_THREAD_ERROR_CONTEXT_H
+
+#ifdef NATIVE_BUILD
+
+#include "error.h"
+
+#else // NATIVE_BUILD
+
+#include <Error.h>
+
+#endif // NATIVE_BUILD
+
+namespace error {
+
+// Holds a sticky error for the calling thread.
+//
+// Low-level functions that are called once per sample can record a failure
+// here instead of returning an Error or ErrorOr<T>. The calling loop then
+// checks the sticky error once per batch instead of once per call.
+//
+// Only the first recorded error is kept, later errors are ignored until the
+// sticky error is cleared. In native builds (-DNATIVE_BUILD) each thread has
+// its own sticky error, on the Arduino platform a single global one is used.
+//
+// Example use:
+//   int Sample(int raw) {
+//     if (raw < 0) {
+//       ThreadErrorContext::Record(Error::INVALID_ARGUMENT);
+//       return 0;
+//     }
+//     return raw * 2;
+//   }
+//
+//   Error ProcessBatch(const int *raw, int *out, int size) {
+//     ThreadErrorContext::Scope scope;
+//     for (int i = 0; i < size; ++i) {
+//       out[i] = Sample(raw[i]);
+//     }
+//     return scope.Release();
+//   }
+class ThreadErrorContext {
+public:
+  // Records the error as the sticky error. Has no effect if the provided
+  // error is Error::OK or if a sticky error was already recorded.
+  static void Record(const Error &error);
+
+  // Determines if no sticky error was recorded.
+  static bool Ok();
+
+  // Returns the sticky error, or Error::OK if none was recorded.
+  static const Error &Get();
+
+  // Clears the sticky error.
+  static void Clear();
+
+  // Converts the sticky error recorded while it is alive into an Error.
+  //
+  // Creating a scope stashes and clears the sticky error recorded by the
+  // enclosing code. When the scope is destroyed the stashed error is restored
+  // unless it was Error::OK, in which case an error recorded inside the scope
+  // and not released stays sticky for the enclosing code.
+  class Scope {
+  public:
+    Scope();
+    ~Scope();
+
+    // Returns the sticky error recorded inside this scope, or Error::OK if
+    // none was recorded, and clears it.
+    Error Release();
+
+  private:
+    // Not copyable, each scope must be destroyed exactly once.
+    Scope(const Scope &);
+    Scope &operator=(const Scope &);
+
+    Error enclosing_error_;
+  };
+
+private:
+  ThreadErrorContext();
+};
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_THREAD_ERROR_CONTEXT_H
@@ -0,0 +1,146 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread_error_context.h"
+
+#include <thread>
+
+#include "error.h"
+#include "error_macros.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::IsOk;
+
+class ThreadErrorContextTest : public ::testing::Test {
+protected:
+  void SetUp() override { ThreadErrorContext::Clear(); }
+  void TearDown() override { ThreadErrorContext::Clear(); }
+};
+
+const int kLibraryNumber = 7;
+
+// A per-sample function that records failures instead of returning them.
+int Double(int sample) {
+  if (sample < 0) {
+    ThreadErrorContext::Record(
+        Error(Error::INVALID_ARGUMENT, kLibraryNumber, sample));
+    return 0;
+  }
+  return sample * 2;
+}
+
+Error DoubleBatch(const int *samples, int *out, int size) {
+  ThreadErrorContext::Scope scope;
+  for (int i = 0; i < size; ++i) {
+    out[i] = Double(samples[i]);
+  }
+  return scope.Release();
+}
+
+TEST_F(ThreadErrorContextTest, OkByDefault) {
+  EXPECT_TRUE(ThreadErrorContext::Ok());
+  EXPECT_THAT(ThreadErrorContext::Get(), IsOk());
+}
+
+TEST_F(ThreadErrorContextTest, RecordsError) {
+  ThreadErrorContext::Record(Error::INTERNAL_ERROR);
+  EXPECT_FALSE(ThreadErrorContext::Ok());
+  EXPECT_THAT(ThreadErrorContext::Get(), ErrorIs(Error::INTERNAL_ERROR));
+}
+
+TEST_F(ThreadErrorContextTest, IgnoresOk) {
+  ThreadErrorContext::Record(Error::OK);
+  EXPECT_TRUE(ThreadErrorContext::Ok());
+}
+
+TEST_F(ThreadErrorContextTest, KeepsFirstError) {
+  ThreadErrorContext::Record(Error::INTERNAL_ERROR);
+  ThreadErrorContext::Record(Error::INVALID_ARGUMENT);
+  EXPECT_THAT(ThreadErrorContext::Get(), ErrorIs(Error::INTERNAL_ERROR));
+}
+
+TEST_F(ThreadErrorContextTest, ClearsError) {
+  ThreadErrorContext::Record(Error::INTERNAL_ERROR);
+  ThreadErrorContext::Clear();
+  EXPECT_TRUE(ThreadErrorContext::Ok());
+}
+
+TEST_F(ThreadErrorContextTest, ScopeReturnsOkWithoutErrors) {
+  const int samples[] = {1, 2, 3};
+  int out[3];
+  EXPECT_OK(DoubleBatch(samples, out, 3));
+  EXPECT_EQ(6, out[2]);
+}
+
+TEST_F(ThreadErrorContextTest, ScopeReturnsFirstErrorInBatch) {
+  const int samples[] = {1, -2, -3, 4};
+  int out[4];
+  EXPECT_THAT(DoubleBatch(samples, out, 4),
+              ErrorIs(Error::INVALID_ARGUMENT, kLibraryNumber, -2));
+  // The batch still processed all samples.
+  EXPECT_EQ(8, out[3]);
+  EXPECT_TRUE(ThreadErrorContext::Ok());
+}
+
+TEST_F(ThreadErrorContextTest, ScopeRestoresEnclosingError) {
+  ThreadErrorContext::Record(Error::INTERNAL_ERROR);
+  {
+    ThreadErrorContext::Scope scope;
+    EXPECT_TRUE(ThreadErrorContext::Ok());
+    ThreadErrorContext::Record(Error::INVALID_ARGUMENT);
+  }
+  EXPECT_THAT(ThreadErrorContext::Get(), ErrorIs(Error::INTERNAL_ERROR));
+}
+
+TEST_F(ThreadErrorContextTest, ScopeKeepsUnreleasedError) {
+  {
+    ThreadErrorContext::Scope scope;
+    ThreadErrorContext::Record(Error::INVALID_ARGUMENT);
+  }
+  EXPECT_THAT(ThreadErrorContext::Get(), ErrorIs(Error::INVALID_ARGUMENT));
+}
+
+Error ForwardBatch(const int *samples, int *out, int size) {
+  RETURN_IF_ERROR(DoubleBatch(samples, out, size));
+  return Error::OK;
+}
+
+TEST_F(ThreadErrorContextTest, WorksWithMacros) {
+  const int samples[] = {-1};
+  int out[1];
+  EXPECT_THAT(ForwardBatch(samples, out, 1), ErrorIs(Error::INVALID_ARGUMENT));
+}
+
+TEST_F(ThreadErrorContextTest, ErrorsAreThreadLocal) {
+  ThreadErrorContext::Record(Error::INTERNAL_ERROR);
+
+  Error other_thread_error;
+  std::thread thread([&other_thread_error]() {
+    other_thread_error = ThreadErrorContext::Get();
+    ThreadErrorContext::Record(Error::INVALID_ARGUMENT);
+  });
+  thread.join();
+
+  EXPECT_THAT(other_thread_error, IsOk());
+  EXPECT_THAT(ThreadErrorContext::Get(), ErrorIs(Error::INTERNAL_ERROR));
+}
+
+} // namespace
+} // namespace error
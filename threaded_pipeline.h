@@ -0,0 +1,326 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the stages of a pipeline on separate threads.
+// Only available in native builds (-DNATIVE_BUILD).
+#ifndef ARDUINO_ERROR_THREADED_PIPELINE_H
+#define ARDUINO_ERROR_THREADED_PIPELINE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "error_or.h"
+#include "pipeline.h"
+
+namespace error {
+namespace internal {
+
+template <int BatchSize, typename Element, typename... Stages>
+class ThreadedStages;
+
+template <typename Element, int BatchSize> class BatchQueue;
+
+} // namespace internal
+
+// Like Pipeline, but each stage runs on its own thread, so consecutive
+// batches are processed by different stages at the same time.
+//
+// The stages are connected by bounded queues of queue_depth batches. All
+// batches are allocated when the pipeline is created and are passed back to
+// the previous stage once processed, so processing doesn't allocate. Push()
+// blocks while the first queue is full. The results are passed to the sink on
+// the thread of the last stage, in the order in which the batches were pushed.
+//
+// The stages are only called from their own thread, so they can keep state
+// without synchronization. Push() and Close() must be called from one thread.
+//
+// Handing a batch to the next thread costs a few microseconds, so this only
+// pays off for batches whose stages take much longer than that, and only with
+// a free core for each stage.
+//
+// Example use:
+//   void Publish(const ErrorOr<float> *temperatures, int count) { ... }
+//
+//   ThreadedPipeline<int, 32, ...> pipeline(4, Publish, Calibrate, ToCelsius);
+//   while (...) {
+//     RETURN_IF_ERROR(pipeline.Push(raw_samples, 32));
+//   }
+//   pipeline.Close();
+template <typename Input, int BatchSize, typename... Stages>
+class ThreadedPipeline {
+public:
+  // The value type returned by the last stage.
+  typedef typename internal::ThreadedStages<BatchSize, Input,
+                                            Stages...>::Output Output;
+
+  // Receives the results of one batch, see Pipeline::Process().
+  typedef ::std::function<void(const ErrorOr<Output> *outputs, int count)>
+      Sink;
+
+  // Starts a thread for each stage.
+  ThreadedPipeline(int queue_depth, Sink sink, Stages... stages);
+
+  // Calls Close().
+  ~ThreadedPipeline();
+
+  // Copies the inputs into the first queue. Returns Error::INVALID_ARGUMENT if
+  // count is negative or larger than BatchSize, and
+  // Error::FAILED_PRECONDITION after Close().
+  Error Push(const Input *inputs, int count);
+
+  // Waits until all pushed batches were passed to the sink and stops the
+  // threads.
+  void Close();
+
+private:
+  // Not copyable.
+  ThreadedPipeline(const ThreadedPipeline &);
+  ThreadedPipeline &operator=(const ThreadedPipeline &);
+
+  internal::BatchQueue<Input, BatchSize> inputs_;
+  internal::ThreadedStages<BatchSize, Input, Stages...> stages_;
+  bool closed_;
+};
+
+//
+// Implementation details of the ThreadedPipeline class.
+//
+
+namespace internal {
+
+// A bounded queue of preallocated batches between two threads. The producer
+// acquires a free batch, fills it and commits it. The consumer takes the
+// committed batches in order and releases them once processed.
+template <typename Element, int BatchSize> class BatchQueue {
+public:
+  struct Batch {
+    Element elements[BatchSize];
+    int count;
+  };
+
+  explicit BatchQueue(int depth);
+
+  // Blocks until a batch is free. Returns nullptr once the queue is closed.
+  Batch *AcquireFree();
+  void Commit(Batch *batch);
+
+  // Blocks until a batch was committed. Returns nullptr once the queue is
+  // closed and all committed batches were taken.
+  Batch *TakeCommitted();
+  void Release(Batch *batch);
+
+  // Wakes up the blocked threads.
+  void Close();
+
+private:
+  // Not copyable.
+  BatchQueue(const BatchQueue &);
+  BatchQueue &operator=(const BatchQueue &);
+
+  ::std::vector<Batch> batches_;
+  ::std::mutex mutex_;
+  ::std::condition_variable released_;
+  ::std::condition_variable committed_;
+  ::std::vector<Batch *> free_;
+  ::std::deque<Batch *> committed_batches_;
+  bool closed_;
+};
+
+template <typename Element, int BatchSize>
+BatchQueue<Element, BatchSize>::BatchQueue(int depth)
+    : batches_(depth > 0 ? depth : 1), closed_(false) {
+  for (Batch &batch : batches_) {
+    free_.push_back(&batch);
+  }
+}
+
+template <typename Element, int BatchSize>
+typename BatchQueue<Element, BatchSize>::Batch *
+BatchQueue<Element, BatchSize>::AcquireFree() {
+  ::std::unique_lock<::std::mutex> lock(mutex_);
+  released_.wait(lock, [this] { return !free_.empty() || closed_; });
+  if (closed_) {
+    return nullptr;
+  }
+  Batch *batch = free_.back();
+  free_.pop_back();
+  return batch;
+}
+
+template <typename Element, int BatchSize>
+void BatchQueue<Element, BatchSize>::Commit(Batch *batch) {
+  {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    committed_batches_.push_back(batch);
+  }
+  committed_.notify_one();
+}
+
+template <typename Element, int BatchSize>
+typename BatchQueue<Element, BatchSize>::Batch *
+BatchQueue<Element, BatchSize>::TakeCommitted() {
+  ::std::unique_lock<::std::mutex> lock(mutex_);
+  committed_.wait(lock,
+                  [this] { return !committed_batches_.empty() || closed_; });
+  if (committed_batches_.empty()) {
+    return nullptr;
+  }
+  Batch *batch = committed_batches_.front();
+  committed_batches_.pop_front();
+  return batch;
+}
+
+template <typename Element, int BatchSize>
+void BatchQueue<Element, BatchSize>::Release(Batch *batch) {
+  {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    free_.push_back(batch);
+  }
+  released_.notify_one();
+}
+
+template <typename Element, int BatchSize>
+void BatchQueue<Element, BatchSize>::Close() {
+  {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    closed_ = true;
+  }
+  released_.notify_all();
+  committed_.notify_all();
+}
+
+// The stages of a threaded pipeline, stored recursively. Element is the type
+// of the elements of the queue feeding the first stage, either the input type
+// of the pipeline or ErrorOr<T>.
+template <int BatchSize, typename Element, typename Stage>
+class ThreadedStages<BatchSize, Element, Stage> {
+public:
+  typedef typename StageOutput<Stage, typename ValueType<Element>::type>::type
+      Output;
+  typedef ::std::function<void(const ErrorOr<Output> *, int)> Sink;
+
+  ThreadedStages(int, Stage stage) : stage_(stage) {}
+
+  // Processes the batches of the queue until it is closed.
+  void Start(BatchQueue<Element, BatchSize> *inputs, Sink sink) {
+    thread_ = ::std::thread([this, inputs, sink] {
+      while (auto *batch = inputs->TakeCommitted()) {
+        int count = batch->count;
+        RunStage(stage_, batch->elements, count, outputs_);
+        inputs->Release(batch);
+        sink(outputs_, count);
+      }
+    });
+  }
+
+  // Waits until the queue was closed and all its batches were processed.
+  void Join() { thread_.join(); }
+
+private:
+  Stage stage_;
+  ErrorOr<Output> outputs_[BatchSize];
+  ::std::thread thread_;
+};
+
+template <int BatchSize, typename Element, typename Stage, typename... Rest>
+class ThreadedStages<BatchSize, Element, Stage, Rest...> {
+  typedef ErrorOr<typename StageOutput<
+      Stage, typename ValueType<Element>::type>::type>
+      Intermediate;
+  typedef ThreadedStages<BatchSize, Intermediate, Rest...> Tail;
+
+public:
+  typedef typename Tail::Output Output;
+  typedef typename Tail::Sink Sink;
+
+  ThreadedStages(int queue_depth, Stage stage, Rest... rest)
+      : stage_(stage), outputs_(queue_depth), tail_(queue_depth, rest...) {}
+
+  void Start(BatchQueue<Element, BatchSize> *inputs, Sink sink) {
+    tail_.Start(&outputs_, sink);
+    thread_ = ::std::thread([this, inputs] {
+      while (auto *batch = inputs->TakeCommitted()) {
+        auto *outputs = outputs_.AcquireFree();
+        outputs->count = batch->count;
+        RunStage(stage_, batch->elements, batch->count, outputs->elements);
+        inputs->Release(batch);
+        outputs_.Commit(outputs);
+      }
+      outputs_.Close();
+    });
+  }
+
+  void Join() {
+    thread_.join();
+    tail_.Join();
+  }
+
+private:
+  Stage stage_;
+  BatchQueue<Intermediate, BatchSize> outputs_;
+  Tail tail_;
+  ::std::thread thread_;
+};
+
+} // namespace internal
+
+template <typename Input, int BatchSize, typename... Stages>
+ThreadedPipeline<Input, BatchSize, Stages...>::ThreadedPipeline(
+    int queue_depth, Sink sink, Stages... stages)
+    : inputs_(queue_depth), stages_(queue_depth, stages...), closed_(false) {
+  stages_.Start(&inputs_, sink);
+}
+
+template <typename Input, int BatchSize, typename... Stages>
+ThreadedPipeline<Input, BatchSize, Stages...>::~ThreadedPipeline() {
+  Close();
+}
+
+template <typename Input, int BatchSize, typename... Stages>
+Error ThreadedPipeline<Input, BatchSize, Stages...>::Push(const Input *inputs,
+                                                          int count) {
+  if (count < 0 || count > BatchSize) {
+    return Error::INVALID_ARGUMENT;
+  }
+  if (closed_) {
+    return Error::FAILED_PRECONDITION;
+  }
+  auto *batch = inputs_.AcquireFree();
+  for (int i = 0; i < count; ++i) {
+    batch->elements[i] = inputs[i];
+  }
+  batch->count = count;
+  inputs_.Commit(batch);
+  return Error::OK;
+}
+
+template <typename Input, int BatchSize, typename... Stages>
+void ThreadedPipeline<Input, BatchSize, Stages...>::Close() {
+  if (!closed_) {
+    closed_ = true;
+    inputs_.Close();
+    stages_.Join();
+  }
+}
+
+} // namespace error
+
+#endif // ARDUINO_ERROR_THREADED_PIPELINE_H
@@ -0,0 +1,130 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "threaded_pipeline.h"
+
+#include <functional>
+#include <vector>
+
+#include "error.h"
+#include "error_or.h"
+#include "gmock/gmock.h"
+#include "testing/error_matchers.h"
+#include "gtest/gtest.h"
+
+namespace error {
+namespace {
+
+using ::testing::error::ErrorIs;
+using ::testing::error::IsOkAndHolds;
+
+const int kBatchSize = 4;
+const int kQueueDepth = 2;
+
+// Fails for negative values.
+ErrorOr<int> CheckPositive(const int &value) {
+  if (value < 0) {
+    return Error(Error::OUT_OF_RANGE, 0, value);
+  }
+  return value;
+}
+
+ErrorOr<long> Square(const int &value) {
+  return static_cast<long>(value) * value;
+}
+
+// Collects the outputs passed to the sink.
+class Collector {
+public:
+  void operator()(const ErrorOr<long> *outputs, int count) {
+    batches_.push_back(count);
+    for (int i = 0; i < count; ++i) {
+      outputs_.push_back(outputs[i]);
+    }
+  }
+
+  std::vector<int> batches_;
+  std::vector<ErrorOr<long>> outputs_;
+};
+
+TEST(ThreadedPipelineTest, ProcessesBatchesInOrder) {
+  Collector collector;
+  {
+    ThreadedPipeline<int, kBatchSize, decltype(&CheckPositive),
+                     decltype(&Square)>
+        pipeline(kQueueDepth, std::ref(collector), CheckPositive, Square);
+    for (int batch = 0; batch < 100; ++batch) {
+      const int inputs[] = {batch, batch + 1, batch + 2};
+      ASSERT_OK(pipeline.Push(inputs, 3));
+    }
+  }
+
+  ASSERT_EQ(100u, collector.batches_.size());
+  ASSERT_EQ(300u, collector.outputs_.size());
+  for (int batch = 0; batch < 100; ++batch) {
+    EXPECT_EQ(3, collector.batches_[batch]);
+    EXPECT_THAT(collector.outputs_[batch * 3],
+                IsOkAndHolds(static_cast<long>(batch) * batch));
+  }
+}
+
+TEST(ThreadedPipelineTest, KeepsErrorsOfSingleInputs) {
+  Collector collector;
+  ThreadedPipeline<int, kBatchSize, decltype(&CheckPositive),
+                   decltype(&Square)>
+      pipeline(kQueueDepth, std::ref(collector), CheckPositive, Square);
+  const int inputs[] = {2, -1, 3};
+  ASSERT_OK(pipeline.Push(inputs, 3));
+  pipeline.Close();
+
+  ASSERT_EQ(3u, collector.outputs_.size());
+  EXPECT_THAT(collector.outputs_[0], IsOkAndHolds(4));
+  EXPECT_THAT(collector.outputs_[1], ErrorIs(Error::OUT_OF_RANGE, 0, -1));
+  EXPECT_THAT(collector.outputs_[2], IsOkAndHolds(9));
+}
+
+TEST(ThreadedPipelineTest, RunsSingleStage) {
+  Collector collector;
+  ThreadedPipeline<int, kBatchSize, decltype(&Square)> pipeline(
+      kQueueDepth, std::ref(collector), Square);
+  const int inputs[] = {5};
+  ASSERT_OK(pipeline.Push(inputs, 1));
+  pipeline.Close();
+
+  ASSERT_EQ(1u, collector.outputs_.size());
+  EXPECT_THAT(collector.outputs_[0], IsOkAndHolds(25));
+}
+
+TEST(ThreadedPipelineTest, RejectsInvalidCount) {
+  Collector collector;
+  ThreadedPipeline<int, kBatchSize, decltype(&Square)> pipeline(
+      kQueueDepth, std::ref(collector), Square);
+  const int inputs[kBatchSize + 1] = {};
+  EXPECT_THAT(pipeline.Push(inputs, kBatchSize + 1),
+              ErrorIs(Error::INVALID_ARGUMENT));
+  EXPECT_THAT(pipeline.Push(inputs, -1), ErrorIs(Error::INVALID_ARGUMENT));
+}
+
+TEST(ThreadedPipelineTest, RejectsPushAfterClose) {
+  Collector collector;
+  ThreadedPipeline<int, kBatchSize, decltype(&Square)> pipeline(
+      kQueueDepth, std::ref(collector), Square);
+  pipeline.Close();
+  const int inputs[] = {1};
+  EXPECT_THAT(pipeline.Push(inputs, 1), ErrorIs(Error::FAILED_PRECONDITION));
+  EXPECT_TRUE(collector.outputs_.empty());
+}
+
+} // namespace
+} // namespace error
@@ -0,0 +1,109 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A sketch that measures the startup time saved by validating a calibration
+// table at compile time. It builds the same table in setup() using validation
+// functions that aren't constexpr and prints how long that took next to the
+// time it takes to read the table computed by the compiler.
+//
+// Usage:
+//   bazel build //tools:constexpr_table_sketch
+//   Upload the firmware and open the serial monitor at 9600 baud.
+
+#include <Arduino.h>
+#include <Error.h>
+#include <Error_or.h>
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorOr;
+
+// The number of entries in the calibration table.
+const int kTableSize = 32;
+
+// The largest calibrated value the sensor can report.
+const int kMaxCalibrated = 1023;
+
+// Computes the calibrated value for the raw reading.
+constexpr int Calibrate(int raw) { return raw * raw / 3 + 7 * raw + 11; }
+
+// Validates the calibrated value.
+constexpr ErrorOr<int> ValidateCalibration(int value) {
+  return (value >= 0 && value <= kMaxCalibrated)
+             ? ErrorOr<int>(value)
+             : ErrorOr<int>(Error::OUT_OF_RANGE);
+}
+
+// The same validation as it had to be written before ErrorOr<T> could be used
+// in constant expressions. Kept out of line, so that the compiler doesn't fold
+// the startup loop.
+__attribute__((noinline)) ErrorOr<int> ValidateAtStartup(int raw) {
+  int value = raw * raw / 3 + 7 * raw + 11;
+  if (value < 0 || value > kMaxCalibrated) {
+    return Error::OUT_OF_RANGE;
+  }
+  return value;
+}
+
+#define ENTRY(raw) ValidateCalibration(Calibrate(raw)).ValueOrDie()
+#define ENTRIES4(raw)                                                          \
+  ENTRY(raw), ENTRY(raw + 1), ENTRY(raw + 2), ENTRY(raw + 3)
+#define ENTRIES16(raw)                                                         \
+  ENTRIES4(raw), ENTRIES4(raw + 4), ENTRIES4(raw + 8), ENTRIES4(raw + 12)
+
+// Computed and validated by the compiler, an invalid entry fails the build.
+constexpr int kCompileTimeTable[kTableSize] = {ENTRIES16(0), ENTRIES16(16)};
+
+#undef ENTRIES16
+#undef ENTRIES4
+#undef ENTRY
+
+// Filled in setup().
+int startup_table[kTableSize];
+
+// Keeps the compiler from optimizing the reads away.
+volatile int sink;
+
+} // namespace
+
+void setup() {
+  Serial.begin(9600);
+
+  unsigned long start = micros();
+  for (int raw = 0; raw < kTableSize; ++raw) {
+    startup_table[raw] = ValidateAtStartup(raw).ValueOrDie();
+  }
+  unsigned long startup_micros = micros() - start;
+
+  start = micros();
+  int sum = 0;
+  for (int raw = 0; raw < kTableSize; ++raw) {
+    sum += kCompileTimeTable[raw];
+  }
+  sink = sum;
+  unsigned long compile_time_micros = micros() - start;
+
+  Serial.print("validated in setup(): ");
+  Serial.print(startup_micros);
+  Serial.println(" us");
+  Serial.print("validated at compile time: ");
+  Serial.print(compile_time_micros);
+  Serial.println(" us");
+  Serial.print("table size: ");
+  Serial.print(static_cast<unsigned int>(sizeof(startup_table)));
+  Serial.println(" bytes");
+}
+
+void loop() {}
@@ -0,0 +1,70 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of Deadline::Check() in a tight loop, with the default
+// stride and with a clock read on every call.
+//
+// Usage:
+//   bazel run -c opt //tools:deadline_benchmark
+
+#include <chrono>
+#include <iostream>
+
+#include "clock.h"
+#include "deadline.h"
+#include "error.h"
+
+namespace {
+
+using ::error::Deadline;
+
+// The number of checks per measurement.
+const int kIterations = 50000000;
+
+// Keeps the compiler from optimizing the loops away.
+volatile int sink;
+
+// Returns the nanoseconds per iteration of a loop checking the deadline.
+double Run(Deadline *deadline) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  int passed = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    if (deadline == nullptr || deadline->Check().Ok()) {
+      ++passed;
+    }
+    sink = i;
+  }
+  Clock::time_point end = Clock::now();
+  if (passed != kIterations) {
+    std::cerr << "unexpected expiration" << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+} // namespace
+
+int main() {
+  const int64_t kHourMicros = 3600000000LL;
+  Deadline strided(kHourMicros);
+  Deadline every_call(kHourMicros, ::error::SystemClock(), 1);
+  Deadline infinite = Deadline::Infinite();
+  std::cout << "no check: " << Run(nullptr) << " ns" << std::endl;
+  std::cout << "stride " << Deadline::kDefaultCheckStride << ": "
+            << Run(&strided) << " ns" << std::endl;
+  std::cout << "stride 1: " << Run(&every_call) << " ns" << std::endl;
+  std::cout << "infinite: " << Run(&infinite) << " ns" << std::endl;
+  return 0;
+}
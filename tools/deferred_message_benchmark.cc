@@ -0,0 +1,101 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares formatting error messages eagerly into an ErrorWithMessage with
+// deferring them in an ErrorWithDeferredMessage, both when the error is
+// discarded and when its message is formatted.
+//
+// Usage:
+//   bazel run -c opt //tools:deferred_message_benchmark
+
+#include <stdio.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "deferred_message.h"
+#include "error.h"
+#include "error_with_message.h"
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorWithDeferredMessage;
+using ::error::ErrorWithMessage;
+using ::error::MakeDeferredMessage;
+
+// The number of errors per measurement.
+const int kIterations = 2000000;
+
+// Keeps the compiler from optimizing the loops away.
+volatile int sink;
+
+// Kept out of line, like a driver would be.
+__attribute__((noinline)) ErrorWithMessage ReadEagerly(int sensor,
+                                                       double value) {
+  char message[::error::kDefaultMessageSize];
+  snprintf(message, sizeof(message), "sensor %d returned %g", sensor, value);
+  return ErrorWithMessage(Error(Error::INTERNAL_ERROR, 1), message);
+}
+
+__attribute__((noinline)) ErrorWithDeferredMessage ReadLazily(int sensor,
+                                                              double value) {
+  return ErrorWithDeferredMessage(
+      Error(Error::INTERNAL_ERROR, 1),
+      MakeDeferredMessage("sensor ", sensor, " returned ", value));
+}
+
+// Returns the length of the message, formatting it if needed.
+size_t MessageLength(const ErrorWithMessage &error) {
+  return std::string(error.Message()).size();
+}
+
+size_t MessageLength(const ErrorWithDeferredMessage &error) {
+  return error.Message().ToString().size();
+}
+
+// Returns the nanoseconds per error created by the function. If format is
+// set, the message of every error is formatted into a string too.
+template <typename E> double Run(E (*read)(int, double), bool format) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  size_t length = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    E error = read(i, 1.5);
+    if (format) {
+      length += MessageLength(error);
+    } else {
+      length += error.Ok() ? 0 : 1;
+    }
+  }
+  Clock::time_point end = Clock::now();
+  sink = static_cast<int>(length);
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+} // namespace
+
+int main() {
+  std::cout << "discarded, eager: " << Run(ReadEagerly, false) << " ns"
+            << std::endl;
+  std::cout << "discarded, deferred: " << Run(ReadLazily, false) << " ns"
+            << std::endl;
+  std::cout << "formatted, eager: " << Run(ReadEagerly, true) << " ns"
+            << std::endl;
+  std::cout << "formatted, deferred: " << Run(ReadLazily, true) << " ns"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the latency of ErrorLogSink::Log() and the number of records the
+// sink writes per second with one and several logging threads.
+//
+// Usage:
+//   bazel run -c opt //tools:error_log_sink_benchmark
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "error_log_sink.h"
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorLogSink;
+using ::error::ErrorLogSinkPolicy;
+
+// The number of records each thread logs.
+const int kRecordsPerThread = 200000;
+
+typedef std::chrono::steady_clock Clock;
+
+// Logs the records and stores the latency of each call in nanoseconds.
+void LogRecords(ErrorLogSink *sink, int thread,
+                std::vector<double> *latencies) {
+  latencies->reserve(kRecordsPerThread);
+  for (int i = 0; i < kRecordsPerThread; ++i) {
+    Clock::time_point start = Clock::now();
+    sink->Log(Error(Error::INTERNAL_ERROR, thread, i));
+    Clock::time_point end = Clock::now();
+    latencies->push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+}
+
+// Returns the value below which the fraction of the sorted values lies.
+double Percentile(const std::vector<double> &sorted, double fraction) {
+  return sorted[static_cast<size_t>(fraction * (sorted.size() - 1))];
+}
+
+void Run(const std::string &path, int num_threads) {
+  unlink(path.c_str());
+  ErrorLogSinkPolicy policy;
+  // Large enough that no records are dropped, so that every call queues one.
+  policy.queue_capacity = kRecordsPerThread;
+  ErrorLogSink sink(policy);
+  Error error = sink.Open(path.c_str());
+  if (!error.Ok()) {
+    std::cerr << "can't open " << path << std::endl;
+    exit(1);
+  }
+
+  std::vector<std::vector<double>> latencies(num_threads);
+  Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back(LogRecords, &sink, t, &latencies[t]);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  sink.Flush();
+  Clock::time_point end = Clock::now();
+
+  std::vector<double> all;
+  for (const std::vector<double> &thread_latencies : latencies) {
+    all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+  }
+  std::sort(all.begin(), all.end());
+  double seconds = std::chrono::duration<double>(end - start).count();
+  std::cout << num_threads << " threads: p50 " << Percentile(all, 0.5)
+            << " ns, p99 " << Percentile(all, 0.99) << " ns, "
+            << sink.Written() / seconds << " records/s, " << sink.Dropped()
+            << " dropped" << std::endl;
+  unlink(path.c_str());
+}
+
+} // namespace
+
+int main() {
+  const char *directory = getenv("TMPDIR");
+  std::string path = std::string(directory != nullptr ? directory : "/tmp") +
+                     "/error_log_sink_benchmark.bin";
+  std::cout << "latencies include reading the clock twice" << std::endl;
+  Run(path, 1);
+  Run(path, 4);
+  return 0;
+}
@@ -0,0 +1,125 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the cost of counting errors in an std::unordered_map keyed by
+// Error with the std::map and a hand written comparator that code used
+// before Error could be hashed.
+//
+// Usage:
+//   bazel run -c opt //tools:error_map_benchmark
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "error.h"
+
+namespace {
+
+using ::error::Error;
+
+// The number of distinct errors and of counted occurrences.
+const int kDistinctErrors = 1000;
+const int kOccurrences = 2000000;
+
+// Orders errors field by field through the accessors.
+struct ErrorLess {
+  bool operator()(const Error &a, const Error &b) const {
+    if (a.CanonicalCode() != b.CanonicalCode()) {
+      return a.CanonicalCode() < b.CanonicalCode();
+    }
+    if (a.LibraryNumber() != b.LibraryNumber()) {
+      return a.LibraryNumber() < b.LibraryNumber();
+    }
+    if (a.ErrorNumber() != b.ErrorNumber()) {
+      return a.ErrorNumber() < b.ErrorNumber();
+    }
+    return a.Subcode() < b.Subcode();
+  }
+};
+
+// Returns errors that only differ in some of their fields, like errors
+// reported by a few libraries would.
+std::vector<Error> MakeErrors() {
+  std::vector<Error> errors;
+  for (int i = 0; i < kOccurrences; ++i) {
+    int id = static_cast<int>((i * 2654435761u) % kDistinctErrors);
+    errors.push_back(Error(static_cast<Error::Code>(1 + id % 4), id % 10,
+                           id / 10 % 10, id / 100));
+  }
+  return errors;
+}
+
+// The number of times each map is measured. The fastest round is reported,
+// so that the order of the measurements doesn't skew them.
+const int kRounds = 5;
+
+// Keeps the compiler from optimizing the lookups away.
+volatile long checksum;
+
+// Nanoseconds per insert and per lookup.
+struct Timing {
+  double insert_nanos;
+  double lookup_nanos;
+};
+
+// Counts the errors in the map, then looks each of them up again.
+template <typename Map> Timing Run(const std::vector<Error> &errors) {
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::duration<double, std::nano> Nanos;
+  Map counts;
+  Clock::time_point start = Clock::now();
+  for (const Error &error : errors) {
+    ++counts[error];
+  }
+  Clock::time_point inserted = Clock::now();
+  long total = 0;
+  for (const Error &error : errors) {
+    total += counts.find(error)->second;
+  }
+  Clock::time_point found = Clock::now();
+  checksum = total;
+  Timing timing = {Nanos(inserted - start).count() / errors.size(),
+                   Nanos(found - inserted).count() / errors.size()};
+  return timing;
+}
+
+void Keep(Timing timing, Timing *best) {
+  best->insert_nanos = std::min(best->insert_nanos, timing.insert_nanos);
+  best->lookup_nanos = std::min(best->lookup_nanos, timing.lookup_nanos);
+}
+
+void Print(const char *name, const Timing &timing) {
+  std::cout << name << ": insert " << timing.insert_nanos << " ns, lookup "
+            << timing.lookup_nanos << " ns" << std::endl;
+}
+
+} // namespace
+
+int main() {
+  const std::vector<Error> errors = MakeErrors();
+  const Timing none = {1e9, 1e9};
+  Timing comparator = none;
+  Timing unordered = none;
+  for (int round = 0; round < kRounds; ++round) {
+    Keep(Run<std::map<Error, int, ErrorLess>>(errors), &comparator);
+    Keep(Run<std::unordered_map<Error, int>>(errors), &unordered);
+  }
+  Print("map", comparator);
+  Print("unordered_map", unordered);
+  return 0;
+}
@@ -0,0 +1,224 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the table lookups of FromWireStatus() and FromErrno() with the same
+// conversions written as switch statements. Each is run on values that repeat,
+// which the branch predictor learns, and on values in random order.
+//
+// Usage:
+//   bazel run -c opt //tools:error_mapping_benchmark
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "error.h"
+#include "error_mapping.h"
+
+namespace {
+
+using ::error::Error;
+
+// The number of conversions per measurement.
+const int kIterations = 20000000;
+
+// The number of distinct inputs each measurement cycles through.
+const int kInputs = 4096;
+
+// Covers all errno values on Linux and some that aren't mapped.
+const int kMaxErrno = 150;
+
+// Keeps the compiler from optimizing the loops away.
+volatile int sink;
+
+Error::Code WireCode(uint8_t status) {
+  switch (status) {
+  case ::error::WIRE_SUCCESS:
+    return Error::OK;
+  case ::error::WIRE_DATA_TOO_LONG:
+    return Error::OUT_OF_RANGE;
+  case ::error::WIRE_ADDRESS_NACK:
+    return Error::NOT_FOUND;
+  case ::error::WIRE_DATA_NACK:
+    return Error::UNAVAILABLE;
+  case ::error::WIRE_TIMEOUT:
+    return Error::DEADLINE_EXCEEDED;
+  default:
+    return Error::UNKNOWN;
+  }
+}
+
+// The same mapping as kErrnoMappings in error_mapping.h.
+Error::Code ErrnoCode(int errno_value) {
+  switch (errno_value) {
+  case 0:
+    return Error::OK;
+  case E2BIG:
+  case EDESTADDRREQ:
+  case EDOM:
+  case EFAULT:
+  case EILSEQ:
+  case EINVAL:
+  case ENAMETOOLONG:
+  case ENOPROTOOPT:
+  case ENOTSOCK:
+  case ENOTTY:
+  case EPROTOTYPE:
+  case ESPIPE:
+    return Error::INVALID_ARGUMENT;
+  case EIO:
+    return Error::INTERNAL_ERROR;
+  case EAFNOSUPPORT:
+  case ENOSYS:
+  case ENOTSUP:
+#if EOPNOTSUPP != ENOTSUP
+  case EOPNOTSUPP:
+#endif
+  case EPROTONOSUPPORT:
+  case EXDEV:
+    return Error::UNIMPLEMENTED;
+  case ENODEV:
+  case ENOENT:
+  case ENXIO:
+  case ESRCH:
+    return Error::NOT_FOUND;
+  case EADDRNOTAVAIL:
+  case EALREADY:
+  case EEXIST:
+    return Error::ALREADY_EXISTS;
+  case EACCES:
+  case EPERM:
+  case EROFS:
+    return Error::PERMISSION_DENIED;
+  case EDQUOT:
+  case EMFILE:
+  case EMLINK:
+  case ENFILE:
+  case ENOBUFS:
+  case ENOMEM:
+  case ENOSPC:
+    return Error::RESOURCE_EXHAUSTED;
+  case EADDRINUSE:
+  case EBADF:
+  case EBUSY:
+  case ECHILD:
+  case EISCONN:
+  case EISDIR:
+  case ENOTCONN:
+  case ENOTDIR:
+  case ENOTEMPTY:
+  case EPIPE:
+  case ETXTBSY:
+    return Error::FAILED_PRECONDITION;
+  case EDEADLK:
+  case ESTALE:
+    return Error::ABORTED;
+  case EFBIG:
+  case EOVERFLOW:
+  case ERANGE:
+    return Error::OUT_OF_RANGE;
+  case EAGAIN:
+  case ECONNABORTED:
+  case ECONNREFUSED:
+  case ECONNRESET:
+  case EHOSTUNREACH:
+  case EINTR:
+  case ENETDOWN:
+  case ENETRESET:
+  case ENETUNREACH:
+  case ENOLCK:
+#if EWOULDBLOCK != EAGAIN
+  case EWOULDBLOCK:
+#endif
+    return Error::UNAVAILABLE;
+  case EBADMSG:
+    return Error::DATA_LOSS;
+  case ECANCELED:
+    return Error::CANCELLED;
+  case ETIMEDOUT:
+    return Error::DEADLINE_EXCEEDED;
+  default:
+    return Error::UNKNOWN;
+  }
+}
+
+// Builds the errors like error_mapping.h does, only the code differs.
+Error WireSwitch(int status) {
+  Error::Code code = WireCode(static_cast<uint8_t>(status));
+  return Error(code, ::error::kUnspecified, ::error::kUnspecified,
+               code == Error::OK ? ::error::kUnspecified : status);
+}
+
+Error ErrnoSwitch(int errno_value) {
+  Error::Code code = ErrnoCode(errno_value);
+  return Error(code, ::error::kUnspecified, ::error::kUnspecified,
+               code == Error::OK ? ::error::kUnspecified : errno_value);
+}
+
+Error WireTable(int status) {
+  return ::error::FromWireStatus(static_cast<uint8_t>(status));
+}
+
+Error ErrnoTable(int errno_value) { return ::error::FromErrno(errno_value); }
+
+// Returns kInputs values, either all the same or drawn from 0 to max_value in
+// random order.
+std::vector<int> MakeInputs(int max_value, bool random) {
+  std::vector<int> inputs(kInputs, max_value / 2);
+  if (random) {
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<int> distribution(0, max_value);
+    for (int &input : inputs) {
+      input = distribution(generator);
+    }
+  }
+  return inputs;
+}
+
+// Returns the nanoseconds per conversion.
+template <Error (*Convert)(int)> double Run(const std::vector<int> &inputs) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  int sum = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    Error error = Convert(inputs[i % kInputs]);
+    sum += error.CanonicalCode() + error.Subcode();
+  }
+  Clock::time_point end = Clock::now();
+  sink = sum;
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+template <Error (*Table)(int), Error (*Switch)(int)>
+void Report(const char *name, int max_value) {
+  for (int random = 0; random < 2; ++random) {
+    std::vector<int> inputs = MakeInputs(max_value, random);
+    const char *order = random ? "random" : "repeated";
+    std::cout << name << ", " << order << ": table " << Run<Table>(inputs)
+              << " ns, switch " << Run<Switch>(inputs) << " ns" << std::endl;
+  }
+}
+
+} // namespace
+
+int main() {
+  Report<WireTable, WireSwitch>("FromWireStatus()", ::error::WIRE_TIMEOUT + 1);
+  Report<ErrnoTable, ErrnoSwitch>("FromErrno()", kMaxErrno);
+  return 0;
+}
@@ -0,0 +1,48 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Prints a snapshot of an error metrics file written by error::ErrorMetrics.
+//
+// Usage:
+//   error_metrics_reader <path>
+
+#include <iostream>
+
+#include "error.h"
+#include "error_metrics.h"
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <path>" << std::endl;
+    return 2;
+  }
+
+  error::ErrorMetricsSnapshot snapshot;
+  error::Error status = error::ReadErrorMetrics(argv[1], &snapshot);
+  if (!status.Ok()) {
+    std::cerr << "Failed to read " << argv[1] << ": ";
+    error::PrintTo(status, &std::cerr);
+    std::cerr << std::endl;
+    return 1;
+  }
+
+  for (const error::ErrorMetric &metric : snapshot.metrics) {
+    error::PrintTo(error::Error(metric.canonical_code, metric.library_number),
+                   &std::cout);
+    std::cout << " count:" << metric.count
+              << " last_seen_nanos:" << metric.last_seen_nanos << std::endl;
+  }
+  std::cout << "overflows:" << snapshot.overflows << std::endl;
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Instantiates ErrorOr<T> for many payload types, so that the size of the
+// generated code can be compared between changes to error_or.h.
+//
+// Usage:
+//   bazel build //tools:error_or_text_size
+//   cat bazel-genfiles/tools/error_or_text_size.txt
+//
+// Build it on two revisions to compare them.
+
+#include "error.h"
+#include "error_or.h"
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorOr;
+
+// The number of distinct payload types.
+const int kInstantiations = 48;
+
+// A distinct payload type for each N.
+template <int N> struct Payload { int value; };
+
+// Kept out of line, so that each instantiation has its own copy of the code
+// like functions of different libraries would.
+template <int N>
+__attribute__((noinline)) ErrorOr<Payload<N>> Produce(int input) {
+  if (input < 0) {
+    return Error(Error::INVALID_ARGUMENT, N);
+  }
+  Payload<N> payload = {input};
+  return payload;
+}
+
+template <int N> __attribute__((noinline)) int Consume(int input) {
+  ErrorOr<Payload<N>> result = Produce<N>(input);
+  if (!result.Ok()) {
+    return result.GetError().LibraryNumber();
+  }
+  return result.ValueOrDie().value;
+}
+
+template <int N> struct ConsumeAll {
+  static int Run(int input) {
+    return Consume<N>(input) + ConsumeAll<N - 1>::Run(input);
+  }
+};
+
+template <> struct ConsumeAll<0> {
+  static int Run(int) { return 0; }
+};
+
+} // namespace
+
+int main(int argc, char **) {
+  return ConsumeAll<kInstantiations>::Run(argc - 2);
+}
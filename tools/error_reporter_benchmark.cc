@@ -0,0 +1,110 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of ErrorReporter::Report() per call when the report is
+// admitted and passed to the handler, and when it is held back because the
+// error is a duplicate or the rate limit is reached.
+//
+// Usage:
+//   bazel run -c opt //tools:error_reporter_benchmark
+
+#include <stdint.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "clock.h"
+#include "error.h"
+#include "error_reporter.h"
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorReport;
+using ::error::ErrorReporter;
+using ::error::ErrorReporterPolicy;
+
+// The number of reports per measurement.
+const int kIterations = 5000000;
+
+// The number of distinct errors reported, twice the slots of the reporter.
+const int kDistinctErrors = 2 * ::error::kDefaultReporterSlots;
+
+// A clock that moves forward by a fixed step every time it is read, so that
+// the reporter sees the same time pattern on every run.
+class SteppingClock : public ::error::Clock {
+public:
+  explicit SteppingClock(int64_t step_micros)
+      : now_micros_(0), step_micros_(step_micros) {}
+
+  int64_t NowMicros() override {
+    now_micros_ += step_micros_;
+    return now_micros_;
+  }
+
+  void SleepMicros(int64_t micros) override { now_micros_ += micros; }
+
+private:
+  int64_t now_micros_;
+  const int64_t step_micros_;
+};
+
+// Counts the emitted records.
+volatile uint32_t emitted;
+
+void CountReport(const ErrorReport &report) { emitted += report.count; }
+
+// Returns the nanoseconds per Report() call. The errors cycle through
+// num_errors distinct library numbers.
+double Run(const ErrorReporterPolicy &policy, int64_t step_micros,
+           int num_errors, uint32_t *reports) {
+  SteppingClock clock(step_micros);
+  ErrorReporter reporter(policy, CountReport, &clock);
+  emitted = 0;
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    reporter.Report(Error(Error::INTERNAL_ERROR, i % num_errors));
+  }
+  Clock::time_point end = Clock::now();
+  *reports = emitted;
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+void Report(const char *name, const ErrorReporterPolicy &policy,
+            int64_t step_micros, int num_errors) {
+  uint32_t reports = 0;
+  double nanos = Run(policy, step_micros, num_errors, &reports);
+  std::cout << name << ": " << nanos << " ns, " << reports << " of "
+            << kIterations << " occurrences emitted" << std::endl;
+}
+
+} // namespace
+
+int main() {
+  ErrorReporterPolicy policy;
+
+  // Every read of the clock is a full summary interval later, so each
+  // occurrence is emitted right away.
+  Report("admitted duplicate", policy, policy.summary_interval_micros, 1);
+  Report("admitted new error", policy, policy.summary_interval_micros,
+         kDistinctErrors);
+
+  // The clock stands still, so duplicates are only counted and new errors
+  // run out of tokens after the first burst.
+  Report("suppressed duplicate", policy, 0, 1);
+  Report("rate limited new error", policy, 0, kDistinctErrors);
+  return 0;
+}
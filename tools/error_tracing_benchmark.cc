@@ -0,0 +1,86 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the overhead of error tracing on the failure and success paths.
+// Build and run it with and without tracing to compare:
+//
+//   bazel run -c opt //tools:error_tracing_benchmark
+//   bazel run -c opt --copt=-DERROR_TRACING //tools:error_tracing_benchmark
+
+#include <chrono>
+#include <iostream>
+
+#include "error.h"
+#include "error_macros.h"
+#include "error_tracing.h"
+
+namespace {
+
+using ::error::Error;
+
+// The number of errors created and handled per measurement.
+const int kIterations = 10000000;
+
+// Returns an error for odd numbers. Kept out of line, like a driver would be.
+__attribute__((noinline)) Error ReadDevice(int value) {
+  return value % 2 == 0
+             ? Error::OK
+             : Error(Error::INTERNAL_ERROR, 1, value % 4, value);
+}
+
+__attribute__((noinline)) Error ReadSensor(int value) {
+  RETURN_IF_ERROR(ReadDevice(value));
+  return Error::OK;
+}
+
+__attribute__((noinline)) Error Poll(int value) {
+  RETURN_IF_ERROR(ReadSensor(value));
+  return Error::OK;
+}
+
+// Calls Poll() with even or odd values and returns the nanoseconds per call.
+double Run(int first_value) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  int failures = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    Error error = Poll(first_value + 2 * i);
+    if (!error.Ok()) {
+      ::error::TraceErrorHandled(error);
+      ++failures;
+    }
+  }
+  Clock::time_point end = Clock::now();
+  if (failures != 0 && failures != kIterations) {
+    std::cerr << "unexpected failures: " << failures << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+} // namespace
+
+int main() {
+#ifdef ERROR_TRACING
+  std::cout << "tracing enabled" << std::endl;
+#else
+  std::cout << "tracing disabled" << std::endl;
+#endif
+  std::cout << "success path: " << Run(0) << " ns per call" << std::endl;
+  std::cout << "failure path: " << Run(1) << " ns per call" << std::endl;
+  ::error::ErrorLatencyReport report = ::error::GetErrorLatencyReport();
+  ::error::PrintTo(report, &std::cout);
+  std::cout << std::endl;
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the size of BasicErrorWithMessage with the plain Error and the time
+// it takes to return them through several calls, both on success and on
+// failure.
+//
+// Usage:
+//   bazel run -c opt //tools:error_with_message_benchmark
+
+#include <stddef.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "error.h"
+#include "error_with_message.h"
+
+namespace {
+
+using ::error::BasicErrorWithMessage;
+using ::error::Error;
+
+// The number of propagations per measurement.
+const int kIterations = 20000000;
+
+// The number of calls each error is returned through.
+const int kDepth = 4;
+
+// Keeps the compiler from optimizing the loops away.
+volatile int sink;
+
+// Creates the error at the bottom of the stack. Kept out of line, like a driver
+// would be.
+template <typename E> __attribute__((noinline)) E MakeError(bool fail) {
+  if (fail) {
+    return E(Error(Error::INTERNAL_ERROR, 1, 2), "sensor not ready");
+  }
+  return Error::OK;
+}
+
+template <> __attribute__((noinline)) Error MakeError<Error>(bool fail) {
+  if (fail) {
+    return Error(Error::INTERNAL_ERROR, 1, 2);
+  }
+  return Error::OK;
+}
+
+// Returns the error of the layer below, like RETURN_IF_ERROR would.
+template <typename E, int Depth> struct Layer {
+  __attribute__((noinline)) static E Call(bool fail) {
+    E error = Layer<E, Depth - 1>::Call(fail);
+    if (!error.Ok()) {
+      return error;
+    }
+    sink = Depth;
+    return Error::OK;
+  }
+};
+
+template <typename E> struct Layer<E, 0> {
+  static E Call(bool fail) { return MakeError<E>(fail); }
+};
+
+// Returns the nanoseconds it takes to return an error through kDepth calls.
+template <typename E> double Run(bool fail) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  int failures = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    if (!Layer<E, kDepth>::Call(fail).Ok()) {
+      ++failures;
+    }
+  }
+  Clock::time_point end = Clock::now();
+  sink = failures;
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+template <typename E> void Report(const char *name) {
+  std::cout << name << ": " << sizeof(E) << " bytes, " << Run<E>(false)
+            << " ns on success, " << Run<E>(true) << " ns on failure"
+            << std::endl;
+}
+
+} // namespace
+
+int main() {
+  std::cout << "returned through " << kDepth << " calls" << std::endl;
+  Report<Error>("Error");
+  Report<BasicErrorWithMessage<16> >("BasicErrorWithMessage<16>");
+  Report<BasicErrorWithMessage<32> >("BasicErrorWithMessage<32>");
+  Report<BasicErrorWithMessage<64> >("BasicErrorWithMessage<64>");
+  return 0;
+}
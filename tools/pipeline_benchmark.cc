@@ -0,0 +1,160 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the throughput of processing samples one at a time through a chain
+// of ASSIGN_OR_RETURN with the batch Pipeline and the ThreadedPipeline.
+//
+// Usage:
+//   bazel run -c opt //tools:pipeline_benchmark
+
+#include <math.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "error.h"
+#include "error_macros.h"
+#include "error_or.h"
+#include "pipeline.h"
+#include "threaded_pipeline.h"
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorOr;
+
+const int kBatchSize = 256;
+const int kBatches = 20000;
+const int kQueueDepth = 4;
+
+// About one in 64 raw samples is out of range.
+const int kMaxRaw = 1008;
+
+// Keeps the compiler from optimizing the results away.
+volatile double sink;
+
+// The stages are function objects, so that they can be inlined into the loops
+// of the pipeline.
+struct Validate {
+  ErrorOr<int> operator()(const int &raw) const {
+    if (raw > kMaxRaw) {
+      return Error(Error::OUT_OF_RANGE, 0, raw);
+    }
+    return raw;
+  }
+};
+
+struct Calibrate {
+  ErrorOr<double> operator()(const int &raw) const {
+    double volts = raw * (3.3 / 1024);
+    return 0.5 + volts * (1.2 + volts * (0.03 + volts * 0.001));
+  }
+};
+
+struct ToTemperature {
+  ErrorOr<double> operator()(const double &calibrated) const {
+    if (calibrated <= 0) {
+      return Error(Error::INVALID_ARGUMENT);
+    }
+    return 1 / (1 / 298.15 + log(calibrated) / 3950) - 273.15;
+  }
+};
+
+ErrorOr<double> ProcessSample(int raw) {
+  ASSIGN_OR_RETURN(int valid, Validate()(raw));
+  ASSIGN_OR_RETURN(double calibrated, Calibrate()(valid));
+  return ToTemperature()(calibrated);
+}
+
+// Fills the batch with pseudo-random raw samples.
+void MakeSamples(int batch, int *samples) {
+  for (int i = 0; i < kBatchSize; ++i) {
+    samples[i] = static_cast<int>(
+        (static_cast<unsigned>(batch * kBatchSize + i) * 7919u) % 1024);
+  }
+}
+
+// Adds the successfully processed outputs to the sink.
+void Consume(const ErrorOr<double> *outputs, int count) {
+  double sum = 0;
+  for (int i = 0; i < count; ++i) {
+    if (outputs[i].Ok()) {
+      sum += outputs[i].ValueOrDie();
+    }
+  }
+  sink = sum;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// Returns the samples per second processed since the start.
+double SamplesPerSecond(Clock::time_point start) {
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  return kBatches * static_cast<double>(kBatchSize) / seconds;
+}
+
+double RunPerSample() {
+  int samples[kBatchSize];
+  ErrorOr<double> outputs[kBatchSize];
+  Clock::time_point start = Clock::now();
+  for (int batch = 0; batch < kBatches; ++batch) {
+    MakeSamples(batch, samples);
+    for (int i = 0; i < kBatchSize; ++i) {
+      outputs[i] = ProcessSample(samples[i]);
+    }
+    Consume(outputs, kBatchSize);
+  }
+  return SamplesPerSecond(start);
+}
+
+double RunPipeline() {
+  auto pipeline = ::error::MakePipeline<int, kBatchSize>(
+      Validate(), Calibrate(), ToTemperature());
+  int samples[kBatchSize];
+  ErrorOr<double> outputs[kBatchSize];
+  Clock::time_point start = Clock::now();
+  for (int batch = 0; batch < kBatches; ++batch) {
+    MakeSamples(batch, samples);
+    pipeline.Process(samples, kBatchSize, outputs);
+    Consume(outputs, kBatchSize);
+  }
+  return SamplesPerSecond(start);
+}
+
+double RunThreadedPipeline() {
+  ::error::ThreadedPipeline<int, kBatchSize, Validate, Calibrate,
+                            ToTemperature>
+      pipeline(kQueueDepth, Consume, Validate(), Calibrate(), ToTemperature());
+  int samples[kBatchSize];
+  Clock::time_point start = Clock::now();
+  for (int batch = 0; batch < kBatches; ++batch) {
+    MakeSamples(batch, samples);
+    pipeline.Push(samples, kBatchSize);
+  }
+  pipeline.Close();
+  return SamplesPerSecond(start);
+}
+
+} // namespace
+
+int main() {
+  std::cout << "per sample: " << RunPerSample() / 1e6 << " M samples/s"
+            << std::endl;
+  std::cout << "pipeline: " << RunPipeline() / 1e6 << " M samples/s"
+            << std::endl;
+  std::cout << "threaded pipeline: " << RunThreadedPipeline() / 1e6
+            << " M samples/s" << std::endl;
+  return 0;
+}
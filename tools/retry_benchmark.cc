@@ -0,0 +1,80 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the overhead of Retry() when the first call succeeds, compared
+// with calling the function directly.
+//
+// Usage:
+//   bazel run -c opt //tools:retry_benchmark
+
+#include <chrono>
+#include <iostream>
+
+#include "error.h"
+#include "error_or.h"
+#include "retry.h"
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorOr;
+using ::error::RetryPolicy;
+using ::error::RetryRule;
+
+// The number of calls per measurement.
+const int kIterations = 20000000;
+
+constexpr RetryRule kRetryable[] = {
+    {Error::INTERNAL_ERROR, ::error::kUnspecified, ::error::kUnspecified},
+};
+
+// Keeps the compiler from optimizing the loops away.
+volatile int sink;
+
+// Always succeeds. Kept out of line, like a driver would be.
+__attribute__((noinline)) ErrorOr<int> ReadSensor() { return sink; }
+
+ErrorOr<int> CallDirectly(const RetryPolicy &) { return ReadSensor(); }
+
+ErrorOr<int> CallWithRetry(const RetryPolicy &policy) {
+  return ::error::Retry(policy, ReadSensor);
+}
+
+// Returns the nanoseconds per call of the function.
+double Run(ErrorOr<int> (*call)(const RetryPolicy &)) {
+  RetryPolicy policy(kRetryable);
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  int failures = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    if (!call(policy).Ok()) {
+      ++failures;
+    }
+    sink = i;
+  }
+  Clock::time_point end = Clock::now();
+  if (failures != 0) {
+    std::cerr << "unexpected failures: " << failures << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+} // namespace
+
+int main() {
+  std::cout << "direct call: " << Run(CallDirectly) << " ns" << std::endl;
+  std::cout << "Retry(): " << Run(CallWithRetry) << " ns" << std::endl;
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the per-sample cost of reporting failures through the sticky
+// ThreadErrorContext, checked once per batch, with returning ErrorOr<T> from
+// every call and checking it with ASSIGN_OR_RETURN.
+//
+// Usage:
+//   bazel run -c opt //tools:thread_error_context_benchmark
+
+#include <chrono>
+#include <iostream>
+
+#include "error.h"
+#include "error_macros.h"
+#include "error_or.h"
+#include "thread_error_context.h"
+
+namespace {
+
+using ::error::Error;
+using ::error::ErrorOr;
+using ::error::ThreadErrorContext;
+
+const int kBatchSize = 256;
+const int kBatches = 100000;
+
+// Keeps the compiler from optimizing the results away.
+volatile int sink;
+
+// Scales a raw sample. Kept out of line, like a function in another
+// translation unit would be.
+__attribute__((noinline)) ErrorOr<int> ScaleOrError(int raw) {
+  if (raw < 0) {
+    return Error(Error::INVALID_ARGUMENT);
+  }
+  return raw * 3 / 2;
+}
+
+__attribute__((noinline)) int ScaleSticky(int raw) {
+  if (raw < 0) {
+    ThreadErrorContext::Record(Error::INVALID_ARGUMENT);
+    return 0;
+  }
+  return raw * 3 / 2;
+}
+
+Error ProcessPerCall(const int *raw, int *out) {
+  for (int i = 0; i < kBatchSize; ++i) {
+    ASSIGN_OR_RETURN(out[i], ScaleOrError(raw[i]));
+  }
+  return Error::OK;
+}
+
+Error ProcessSticky(const int *raw, int *out) {
+  ThreadErrorContext::Scope scope;
+  for (int i = 0; i < kBatchSize; ++i) {
+    out[i] = ScaleSticky(raw[i]);
+  }
+  return scope.Release();
+}
+
+// Returns the nanoseconds per sample spent by the function processing
+// batches that all succeed.
+double Run(Error (*process)(const int *, int *)) {
+  int raw[kBatchSize];
+  int out[kBatchSize];
+  for (int i = 0; i < kBatchSize; ++i) {
+    raw[i] = i;
+  }
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  int failures = 0;
+  for (int batch = 0; batch < kBatches; ++batch) {
+    if (!process(raw, out).Ok()) {
+      ++failures;
+    }
+    sink = out[batch % kBatchSize];
+  }
+  Clock::time_point end = Clock::now();
+  if (failures != 0) {
+    std::cerr << "unexpected failures: " << failures << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (static_cast<double>(kBatches) * kBatchSize);
+}
+
+} // namespace
+
+int main() {
+  std::cout << "ASSIGN_OR_RETURN per call: " << Run(ProcessPerCall)
+            << " ns per sample" << std::endl;
+  std::cout << "ThreadErrorContext per batch: " << Run(ProcessSticky)
+            << " ns per sample" << std::endl;
+  return 0;
+}